@@ -0,0 +1,258 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "BenchSupport.h"
+#include "PixelKernels.h"
+#include "ParallelFor.h"
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QImage>
+#include <cstdlib>
+
+// Compares the original chained adjustments, three passes with a full copy
+// each, against the fused single pass per kernel. Before timing, every
+// kernel is run over a sweep of slider settings and must stay within 1 per
+// channel of the chained passes; the bench fails otherwise.
+// Usage: adjust_bench [runs]
+
+namespace {
+
+struct Setting {
+    int brightness;
+    int contrast;
+    int saturation;
+};
+
+// The timed setting
+const Setting kTimed = {20, 30, 40};
+
+// The pre-fusion implementation, kept here as the baseline
+QImage chainedBrightness(const QImage &image, int brightness)
+{
+    QImage result = image.convertToFormat(QImage::Format_ARGB32);
+    int adjustment = brightness * 255 / 100;
+    
+    for (int y = 0; y < result.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
+        for (int x = 0; x < result.width(); ++x) {
+            QRgb pixel = line[x];
+            int r = qBound(0, qRed(pixel) + adjustment, 255);
+            int g = qBound(0, qGreen(pixel) + adjustment, 255);
+            int b = qBound(0, qBlue(pixel) + adjustment, 255);
+            line[x] = qRgba(r, g, b, qAlpha(pixel));
+        }
+    }
+    
+    return result;
+}
+
+QImage chainedContrast(const QImage &image, int contrast)
+{
+    QImage result = image.convertToFormat(QImage::Format_ARGB32);
+    double factor = (259.0 * (contrast + 255.0)) / (255.0 * (259.0 - contrast));
+    
+    for (int y = 0; y < result.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
+        for (int x = 0; x < result.width(); ++x) {
+            QRgb pixel = line[x];
+            int r = qBound(0, static_cast<int>(factor * (qRed(pixel) - 128) + 128), 255);
+            int g = qBound(0, static_cast<int>(factor * (qGreen(pixel) - 128) + 128), 255);
+            int b = qBound(0, static_cast<int>(factor * (qBlue(pixel) - 128) + 128), 255);
+            line[x] = qRgba(r, g, b, qAlpha(pixel));
+        }
+    }
+    
+    return result;
+}
+
+QImage chainedSaturation(const QImage &image, int saturation)
+{
+    QImage result = image.convertToFormat(QImage::Format_ARGB32);
+    double factor = (saturation + 100.0) / 100.0;
+    
+    for (int y = 0; y < result.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
+        for (int x = 0; x < result.width(); ++x) {
+            QRgb pixel = line[x];
+            int r = qRed(pixel);
+            int g = qGreen(pixel);
+            int b = qBlue(pixel);
+            int gray = static_cast<int>(0.299 * r + 0.587 * g + 0.114 * b);
+            r = qBound(0, static_cast<int>(gray + factor * (r - gray)), 255);
+            g = qBound(0, static_cast<int>(gray + factor * (g - gray)), 255);
+            b = qBound(0, static_cast<int>(gray + factor * (b - gray)), 255);
+            line[x] = qRgba(r, g, b, qAlpha(pixel));
+        }
+    }
+    
+    return result;
+}
+
+QImage chained(const QImage &image, const Setting &setting)
+{
+    return chainedSaturation(chainedContrast(chainedBrightness(image, setting.brightness), setting.contrast),
+                             setting.saturation);
+}
+
+QImage fused(const QImage &image, PixelKernels::RowFunction function, bool threaded, const Setting &setting)
+{
+    const PixelKernels::Params params = PixelKernels::makeParams(setting.brightness, setting.contrast,
+                                                                 setting.saturation);
+    QImage result(image.size(), QImage::Format_ARGB32);
+    auto rows = [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            function(reinterpret_cast<const QRgb*>(image.constScanLine(y)),
+                     reinterpret_cast<QRgb*>(result.scanLine(y)), image.width(), params);
+        }
+    };
+    if (threaded) {
+        ParallelFor::run(image.height(), rows);
+    } else {
+        rows(0, image.height());
+    }
+    return result;
+}
+
+int maxChannelDifference(const QImage &a, const QImage &b)
+{
+    int difference = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        const QRgb *lineA = reinterpret_cast<const QRgb*>(a.constScanLine(y));
+        const QRgb *lineB = reinterpret_cast<const QRgb*>(b.constScanLine(y));
+        for (int x = 0; x < a.width(); ++x) {
+            difference = qMax(difference, std::abs(qRed(lineA[x]) - qRed(lineB[x])));
+            difference = qMax(difference, std::abs(qGreen(lineA[x]) - qGreen(lineB[x])));
+            difference = qMax(difference, std::abs(qBlue(lineA[x]) - qBlue(lineB[x])));
+        }
+    }
+    return difference;
+}
+
+// Largest channel difference from the chained passes per kernel, over every
+// combination of seven values per slider on a photo-like and a noise image
+bool checkAccuracy(QTextStream &out)
+{
+    const QList<int> values = {-100, -60, -20, 0, 20, 60, 100};
+    QList<Setting> settings;
+    for (int brightness : values) {
+        for (int contrast : values) {
+            for (int saturation : values) {
+                settings.append({brightness, contrast, saturation});
+            }
+        }
+    }
+    const QList<QImage> images = {
+        BenchSupport::syntheticImage(BenchSupport::Pattern::Photo, 512, 512),
+        BenchSupport::syntheticImage(BenchSupport::Pattern::Noise, 512, 512)
+    };
+    
+    QList<int> worst(3, 0);
+    QList<Setting> worstSetting(3, Setting{0, 0, 0});
+    for (const Setting &setting : settings) {
+        for (const QImage &image : images) {
+            const QImage reference = chained(image, setting);
+            for (PixelKernels::Isa isa : {PixelKernels::Isa::Scalar, PixelKernels::Isa::SSE41,
+                                          PixelKernels::Isa::AVX2}) {
+                PixelKernels::RowFunction function = PixelKernels::rowFunction(isa);
+                if (!function) {
+                    continue;
+                }
+                const int index = static_cast<int>(isa);
+                const int difference = maxChannelDifference(reference, fused(image, function, false, setting));
+                if (difference > worst[index]) {
+                    worst[index] = difference;
+                    worstSetting[index] = setting;
+                }
+            }
+        }
+    }
+    
+    bool ok = true;
+    out << QString("Accuracy over %1 slider settings, largest channel difference from chained:\n")
+           .arg(settings.size());
+    for (PixelKernels::Isa isa : {PixelKernels::Isa::Scalar, PixelKernels::Isa::SSE41, PixelKernels::Isa::AVX2}) {
+        if (!PixelKernels::rowFunction(isa)) {
+            continue;
+        }
+        const int index = static_cast<int>(isa);
+        out << QString("  %1 %2").arg(PixelKernels::isaName(isa), -8).arg(worst[index]);
+        if (worst[index] > 1) {
+            const Setting &setting = worstSetting[index];
+            out << QString("  FAILED, more than 1 (brightness %1, contrast %2, saturation %3)")
+                   .arg(setting.brightness).arg(setting.contrast).arg(setting.saturation);
+            ok = false;
+        }
+        out << "\n";
+    }
+    return ok;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    
+    int runs = 7;
+    if (app.arguments().size() > 1) {
+        runs = qMax(1, app.arguments().at(1).toInt());
+    }
+    
+    if (!checkAccuracy(out)) {
+        return 1;
+    }
+    
+    const QList<QSize> sizes = {QSize(6000, 4000), QSize(8000, 6000)};
+    out << QString("\nBrightness %1, contrast %2, saturation %3; median of %4 runs\n")
+           .arg(kTimed.brightness).arg(kTimed.contrast).arg(kTimed.saturation).arg(runs);
+    
+    for (const QSize &size : sizes) {
+        const QImage source = BenchSupport::syntheticImage(BenchSupport::Pattern::Photo, size.width(),
+                                                           size.height());
+        out << QString("\n%1x%2 (%3 MP)\n").arg(size.width()).arg(size.height())
+               .arg(size.width() * size.height() / 1e6, 0, 'f', 1);
+        
+        auto report = [&](const QString &name, double ms, double baselineMs) {
+            out << QString("  %1 %2 ms  %3 MP/s  %4x\n")
+                   .arg(name, -24)
+                   .arg(ms, 8, 'f', 1)
+                   .arg(BenchSupport::megapixelsPerSecond(size, ms), 7, 'f', 1)
+                   .arg(baselineMs / ms, 5, 'f', 2);
+        };
+        
+        const double chainedMs = BenchSupport::measure(runs, [&]() {
+            QImage result = chained(source, kTimed);
+            Q_UNUSED(result);
+        }).medianMs;
+        report("chained, 1 thread", chainedMs, chainedMs);
+        
+        const QImage reference = chained(source, kTimed);
+        for (PixelKernels::Isa isa : {PixelKernels::Isa::Scalar, PixelKernels::Isa::SSE41,
+                                      PixelKernels::Isa::AVX2}) {
+            PixelKernels::RowFunction function = PixelKernels::rowFunction(isa);
+            if (!function) {
+                continue;
+            }
+            const double ms = BenchSupport::measure(runs, [&]() {
+                QImage result = fused(source, function, false, kTimed);
+                Q_UNUSED(result);
+            }).medianMs;
+            report(QString("fused %1, 1 thread").arg(PixelKernels::isaName(isa)), ms, chainedMs);
+            out << QString("    max channel difference from chained: %1\n")
+                   .arg(maxChannelDifference(reference, fused(source, function, false, kTimed)));
+        }
+        
+        const PixelKernels::Isa active = PixelKernels::activeIsa();
+        const double threadedMs = BenchSupport::measure(runs, [&]() {
+            QImage result = fused(source, PixelKernels::rowFunction(active), true, kTimed);
+            Q_UNUSED(result);
+        }).medianMs;
+        report(QString("fused %1, %2 thread(s)").arg(PixelKernels::isaName(active))
+               .arg(ParallelFor::threadCount()), threadedMs, chainedMs);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,162 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "BenchSupport.h"
+#include "ParallelFor.h"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+quint32 hash(quint32 x, quint32 y, quint32 seed)
+{
+    // Murmur3 finalizer over a mix of the coordinates
+    quint32 h = x * 0x8da6b343u ^ y * 0xd8163841u ^ seed * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Bilinearly interpolated lattice noise in [0, 1] with one lattice point
+// every cell pixels
+double valueNoise(int x, int y, int cell, quint32 seed)
+{
+    const quint32 gx = static_cast<quint32>(x / cell);
+    const quint32 gy = static_cast<quint32>(y / cell);
+    const double fx = static_cast<double>(x % cell) / cell;
+    const double fy = static_cast<double>(y % cell) / cell;
+    
+    const double v00 = (hash(gx, gy, seed) & 0xffff) / 65535.0;
+    const double v10 = (hash(gx + 1, gy, seed) & 0xffff) / 65535.0;
+    const double v01 = (hash(gx, gy + 1, seed) & 0xffff) / 65535.0;
+    const double v11 = (hash(gx + 1, gy + 1, seed) & 0xffff) / 65535.0;
+    
+    const double top = v00 + (v10 - v00) * fx;
+    const double bottom = v01 + (v11 - v01) * fx;
+    return top + (bottom - top) * fy;
+}
+
+QRgb photoPixel(int x, int y, int width, int height)
+{
+    const double u = static_cast<double>(x) / width;
+    const double v = static_cast<double>(y) / height;
+    
+    // Feature sizes scale with the image so every resolution shows the same scene
+    const int coarse = qMax(1, width / 6);
+    const int medium = qMax(1, width / 40);
+    const int fine = qMax(1, width / 250);
+    const double texture = 0.5 * valueNoise(x, y, coarse, 1)
+                         + 0.3 * valueNoise(x, y, medium, 2)
+                         + 0.2 * valueNoise(x, y, fine, 3);
+    const int grain = static_cast<int>(hash(x, y, 4) & 0x0f) - 8;
+    
+    const double horizon = 0.55 + 0.05 * std::sin(u * 12.566) + 0.08 * (valueNoise(x, 0, coarse, 5) - 0.5);
+    double r, g, b;
+    if (v < horizon) {
+        // Sky: darker blue at the top, hazy towards the horizon, soft clouds
+        const double haze = v / horizon;
+        const double cloud = qMax(0.0, texture - 0.55) * 2.0;
+        r = 70 + 110 * haze + 150 * cloud;
+        g = 110 + 90 * haze + 130 * cloud;
+        b = 190 + 40 * haze + 60 * cloud;
+    } else {
+        // Ground: textured greens and browns, darker towards the bottom
+        const double depth = (v - horizon) / (1.0 - horizon);
+        const double shade = 1.0 - 0.5 * depth;
+        r = (60 + 110 * texture) * shade;
+        g = (80 + 100 * texture) * shade;
+        b = (30 + 50 * texture) * shade;
+    }
+    
+    return qRgb(qBound(0, static_cast<int>(r) + grain, 255),
+                qBound(0, static_cast<int>(g) + grain, 255),
+                qBound(0, static_cast<int>(b) + grain, 255));
+}
+
+} // namespace
+
+QImage BenchSupport::syntheticImage(Pattern pattern, int width, int height)
+{
+    QImage image(width, height, QImage::Format_RGB32);
+    ParallelFor::run(height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+            for (int x = 0; x < width; ++x) {
+                switch (pattern) {
+                case Pattern::Gradient:
+                    line[x] = qRgb(x * 255 / width, y * 255 / height, (x + y) * 255 / (width + height));
+                    break;
+                case Pattern::Noise: {
+                    const quint32 h = hash(x, y, 0);
+                    line[x] = qRgb(h & 0xff, (h >> 8) & 0xff, (h >> 16) & 0xff);
+                    break;
+                }
+                case Pattern::Photo:
+                    line[x] = photoPixel(x, y, width, height);
+                    break;
+                }
+            }
+        }
+    });
+    return image;
+}
+
+QString BenchSupport::patternName(Pattern pattern)
+{
+    switch (pattern) {
+    case Pattern::Gradient:
+        return "gradient";
+    case Pattern::Noise:
+        return "noise";
+    case Pattern::Photo:
+        return "photo";
+    }
+    return QString();
+}
+
+bool BenchSupport::parsePattern(const QString &name, Pattern *pattern)
+{
+    for (Pattern candidate : {Pattern::Gradient, Pattern::Noise, Pattern::Photo}) {
+        if (patternName(candidate) == name) {
+            *pattern = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QStringList BenchSupport::patternNames()
+{
+    return {patternName(Pattern::Gradient), patternName(Pattern::Noise), patternName(Pattern::Photo)};
+}
+
+BenchSupport::Timing BenchSupport::measure(int runs, const std::function<void()> &body)
+{
+    std::vector<double> times;
+    for (int i = 0; i < qMax(1, runs); ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        body();
+        times.push_back(timer.nsecsElapsed() / 1e6);
+    }
+    std::sort(times.begin(), times.end());
+    
+    const size_t p95Rank = static_cast<size_t>(std::ceil(0.95 * times.size()));
+    return {times[times.size() / 2], times[qMax<size_t>(1, p95Rank) - 1]};
+}
+
+double BenchSupport::megapixelsPerSecond(const QSize &size, double ms)
+{
+    if (ms <= 0.0) {
+        return 0.0;
+    }
+    return size.width() * static_cast<double>(size.height()) / 1e6 / (ms / 1000.0);
+}
@@ -0,0 +1,42 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef BENCHSUPPORT_H
+#define BENCHSUPPORT_H
+
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+// Shared pieces of the benchmarks: deterministic test images and timing
+// statistics. Every pixel is a pure function of its position, so images are
+// identical across runs, machines and thread counts.
+class BenchSupport
+{
+public:
+    enum class Pattern {
+        Gradient,   // Smooth ramps, the easy case for encoders
+        Noise,      // Independent random pixels, the worst case
+        Photo       // Sky, horizon and multi-scale texture with grain
+    };
+    
+    struct Timing {
+        double medianMs;
+        double p95Ms;       // Nearest rank, so the slowest run when runs < 20
+    };
+    
+    static QImage syntheticImage(Pattern pattern, int width, int height);
+    static QString patternName(Pattern pattern);
+    static bool parsePattern(const QString &name, Pattern *pattern);
+    static QStringList patternNames();
+    
+    // Runs body the given number of times
+    static Timing measure(int runs, const std::function<void()> &body);
+    static double megapixelsPerSecond(const QSize &size, double ms);
+};
+
+#endif // BENCHSUPPORT_H
@@ -0,0 +1,106 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "BenchSupport.h"
+#include "ImageProcessor.h"
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QFileInfo>
+#include <QImage>
+#include <QPair>
+
+// Encode time and file size for every format and encoder speed preset.
+// Usage: encode_bench [runs] [images...]
+// Without images a synthetic 8K frame is used; pass real photos for numbers
+// that reflect how well each preset compresses.
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    QStringList arguments = app.arguments().mid(1);
+    int runs = 5;
+    if (!arguments.isEmpty()) {
+        bool ok = false;
+        int value = arguments.first().toInt(&ok);
+        if (ok) {
+            runs = qMax(1, value);
+            arguments.removeFirst();
+        }
+    }
+    
+    QList<QPair<QString, QImage>> inputs;
+    for (const QString &path : arguments) {
+        QImage image(path);
+        if (image.isNull()) {
+            err << "Cannot read " << path << "\n";
+            return 1;
+        }
+        inputs.append({QFileInfo(path).fileName(), image});
+    }
+    if (inputs.isEmpty()) {
+        inputs.append({"synthetic 8K",
+                       BenchSupport::syntheticImage(BenchSupport::Pattern::Photo, 7680, 4320)});
+    }
+    
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        err << "Cannot create a temporary directory\n";
+        return 1;
+    }
+    
+    out << "Median of " << runs << " runs\n";
+    
+    for (const auto &input : inputs) {
+        out << "\n" << input.first << " (" << input.second.width() << "x" << input.second.height() << ")\n";
+        
+        for (ImageProcessor::OutputFormat format : ImageProcessor::getAvailableOutputFormats()) {
+            ImageProcessor::FormatInfo info = ImageProcessor::getFormatInfo(format);
+            const QString path = dir.filePath("bench." + info.extension);
+            
+            // Formats without presets are timed once as a reference point
+            QList<ImageProcessor::EncoderSpeed> speeds;
+            if (info.speedPresets.isEmpty()) {
+                speeds << ImageProcessor::EncoderSpeed::Balanced;
+            } else {
+                speeds << ImageProcessor::EncoderSpeed::Fast << ImageProcessor::EncoderSpeed::Balanced
+                       << ImageProcessor::EncoderSpeed::Smallest;
+            }
+            
+            for (ImageProcessor::EncoderSpeed speed : speeds) {
+                ImageProcessor::EncodeOptions options;
+                options.quality = 85;
+                options.maxFileBytes = 0;
+                options.speeds.insert(format, speed);
+                
+                QString error;
+                BenchSupport::Timing timing = BenchSupport::measure(runs, [&]() {
+                    if (error.isEmpty()) {
+                        ImageProcessor::encodeImage(input.second, path, format, options, &error);
+                    }
+                });
+                if (!error.isEmpty()) {
+                    err << "Encoding " << info.extension.toUpper() << " failed: " << error << "\n";
+                    return 1;
+                }
+                
+                QString label = info.extension.toUpper();
+                if (!info.speedPresets.isEmpty()) {
+                    label += " " + ImageProcessor::encoderSpeedName(speed);
+                }
+                out << QString("  %1 %2 ms  %3 KB\n")
+                       .arg(label, -16)
+                       .arg(timing.medianMs, 8, 'f', 1)
+                       .arg(QFileInfo(path).size() / 1024, 8);
+            }
+        }
+    }
+    
+    return 0;
+}
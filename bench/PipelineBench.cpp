@@ -0,0 +1,291 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "BenchSupport.h"
+#include "ImageProcessor.h"
+#include "PixelKernels.h"
+#include "ParallelFor.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFileInfo>
+#include <QImage>
+#include <algorithm>
+
+// Times each stage of the wallpaper pipeline on synthetic images: decoding,
+// the adjustment kernels, crop and resample, and encoding to every output
+// format. Prints a table, or with --json a document that can be kept per
+// release and diffed to spot regressions.
+
+namespace {
+
+struct SourceSize {
+    QString name;
+    QSize size;
+};
+
+const QList<SourceSize> &sourceSizes()
+{
+    static const QList<SourceSize> sizes = {
+        {"1080p", QSize(1920, 1080)},
+        {"4k", QSize(3840, 2160)},
+        {"8k", QSize(7680, 4320)},
+        {"50mp", QSize(8660, 5773)},
+    };
+    return sizes;
+}
+
+struct Result {
+    QString pattern;
+    QSize size;
+    QString stage;
+    QString variant;
+    BenchSupport::Timing timing;
+    double megapixelsPerSecond;
+    qint64 bytes;           // Encoded size for load and save, otherwise -1
+};
+
+QJsonObject toJson(const Result &result)
+{
+    QJsonObject object;
+    object["pattern"] = result.pattern;
+    object["width"] = result.size.width();
+    object["height"] = result.size.height();
+    object["stage"] = result.stage;
+    object["variant"] = result.variant;
+    object["median_ms"] = result.timing.medianMs;
+    object["p95_ms"] = result.timing.p95Ms;
+    object["mp_per_s"] = result.megapixelsPerSecond;
+    if (result.bytes >= 0) {
+        object["bytes"] = result.bytes;
+    }
+    return object;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("wallpapermaker_bench");
+    QCoreApplication::setApplicationVersion("1.0.0");
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    QStringList sizeNames;
+    for (const SourceSize &size : sourceSizes()) {
+        sizeNames << size.name;
+    }
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the WallpaperMaker image pipeline on synthetic images.");
+    parser.addHelpOption();
+    QCommandLineOption runsOption(QStringList() << "n" << "runs", "Runs per measurement.", "runs", "5");
+    QCommandLineOption sizeOption(QStringList() << "s" << "size",
+        QString("Source sizes, comma separated: %1.").arg(sizeNames.join(", ")), "sizes", sizeNames.join(","));
+    QCommandLineOption patternOption(QStringList() << "p" << "pattern",
+        QString("Image patterns, comma separated: %1.").arg(BenchSupport::patternNames().join(", ")),
+        "patterns", "photo");
+    QCommandLineOption jsonOption("json", "Print the results as JSON.");
+    parser.addOption(runsOption);
+    parser.addOption(sizeOption);
+    parser.addOption(patternOption);
+    parser.addOption(jsonOption);
+    parser.process(app);
+    
+    bool ok = false;
+    const int runs = parser.value(runsOption).toInt(&ok);
+    if (!ok || runs < 1) {
+        err << "Runs must be a positive number\n";
+        return 1;
+    }
+    
+    QList<SourceSize> sizes;
+    for (const QString &name : parser.value(sizeOption).toLower().split(',', Qt::SkipEmptyParts)) {
+        auto it = std::find_if(sourceSizes().begin(), sourceSizes().end(), [&](const SourceSize &size) {
+            return size.name == name.trimmed();
+        });
+        if (it == sourceSizes().end()) {
+            err << "Unknown size: " << name << "\n";
+            return 1;
+        }
+        sizes << *it;
+    }
+    
+    QList<BenchSupport::Pattern> patterns;
+    for (const QString &name : parser.value(patternOption).toLower().split(',', Qt::SkipEmptyParts)) {
+        BenchSupport::Pattern pattern;
+        if (!BenchSupport::parsePattern(name.trimmed(), &pattern)) {
+            err << "Unknown pattern: " << name << "\n";
+            return 1;
+        }
+        patterns << pattern;
+    }
+    
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        err << "Cannot create a temporary directory\n";
+        return 1;
+    }
+    
+    const bool json = parser.isSet(jsonOption);
+    const QList<ImageProcessor::OutputFormat> formats = ImageProcessor::getAvailableOutputFormats();
+    const QList<QSize> targets = {QSize(1920, 1080), QSize(3840, 2160)};
+    ImageProcessor processor;
+    ImageProcessor::EncodeOptions encodeOptions;
+    encodeOptions.quality = processor.getJpegQuality();
+    encodeOptions.maxFileBytes = 0;
+    
+    if (!json) {
+        out << "Kernels: " << PixelKernels::isaName(PixelKernels::activeIsa())
+            << ", threads: " << ParallelFor::threadCount() << ", median and p95 of " << runs << " runs\n";
+    }
+    
+    QList<Result> results;
+    for (BenchSupport::Pattern pattern : patterns) {
+        for (const SourceSize &sourceSize : sizes) {
+            const QSize size = sourceSize.size;
+            const QImage source = BenchSupport::syntheticImage(pattern, size.width(), size.height());
+            const int first = results.size();
+            
+            auto record = [&](const QString &stage, const QString &variant, const QSize &pixels,
+                              const BenchSupport::Timing &timing, qint64 bytes) {
+                results.append({BenchSupport::patternName(pattern), size, stage, variant, timing,
+                                BenchSupport::megapixelsPerSecond(pixels, timing.medianMs), bytes});
+            };
+            
+            // Decoding, from files written with the default encoder settings
+            for (ImageProcessor::OutputFormat format : formats) {
+                const QString extension = ImageProcessor::getFormatInfo(format).extension;
+                const QString path = dir.filePath("load." + extension);
+                QString error;
+                if (!ImageProcessor::encodeImage(source, path, format, encodeOptions, &error)) {
+                    err << "Encoding " << extension << " failed: " << error << "\n";
+                    return 1;
+                }
+                BenchSupport::Timing timing = BenchSupport::measure(runs, [&]() {
+                    QImage image = ImageProcessor::decodeImage(path);
+                    Q_UNUSED(image);
+                });
+                record("load", extension, size, timing, QFileInfo(path).size());
+            }
+            
+            // Each adjustment on its own, then all three in one pass
+            struct Adjustment {
+                QString name;
+                int brightness;
+                int contrast;
+                int saturation;
+            };
+            const QList<Adjustment> adjustments = {
+                {"brightness", 30, 0, 0},
+                {"contrast", 0, 30, 0},
+                {"saturation", 0, 0, 30},
+                {"all", 30, 30, 30},
+            };
+            for (const Adjustment &adjustment : adjustments) {
+                processor.setBrightness(adjustment.brightness);
+                processor.setContrast(adjustment.contrast);
+                processor.setSaturation(adjustment.saturation);
+                BenchSupport::Timing timing = BenchSupport::measure(runs, [&]() {
+                    QImage image = processor.applyAdjustments(source);
+                    Q_UNUSED(image);
+                });
+                record("adjust", adjustment.name, size, timing, -1);
+            }
+            processor.setBrightness(0);
+            processor.setContrast(0);
+            processor.setSaturation(0);
+            
+            // Center crop resampled to the common wallpaper sizes
+            for (const QSize &target : targets) {
+                const QRect cropRect = ImageProcessor::centerCropRect(size, target);
+                BenchSupport::Timing timing = BenchSupport::measure(runs, [&]() {
+                    QImage image = ImageProcessor::cropAndScale(source, target, cropRect);
+                    Q_UNUSED(image);
+                });
+                record("cropAndScale", QString("%1x%2").arg(target.width()).arg(target.height()),
+                       cropRect.size(), timing, -1);
+            }
+            
+            // A 1080p export with all adjustments, in the original order
+            // (adjust the whole image, then crop and resample) and in the
+            // order the export pipeline uses (crop and resample, then adjust)
+            const QSize exportSize(1920, 1080);
+            const QRect exportRect = ImageProcessor::centerCropRect(size, exportSize);
+            processor.setBrightness(30);
+            processor.setContrast(30);
+            processor.setSaturation(30);
+            BenchSupport::Timing adjustFirst = BenchSupport::measure(runs, [&]() {
+                QImage image = ImageProcessor::cropAndScale(processor.applyAdjustments(source), exportSize,
+                                                            exportRect);
+                Q_UNUSED(image);
+            });
+            record("export", "adjust-crop", size, adjustFirst, -1);
+            BenchSupport::Timing cropFirst = BenchSupport::measure(runs, [&]() {
+                QImage image = processor.applyAdjustments(ImageProcessor::cropAndScale(source, exportSize,
+                                                                                       exportRect));
+                Q_UNUSED(image);
+            });
+            record("export", "crop-adjust", size, cropFirst, -1);
+            processor.setBrightness(0);
+            processor.setContrast(0);
+            processor.setSaturation(0);
+            
+            // Saving the full image in each format
+            for (ImageProcessor::OutputFormat format : formats) {
+                const QString basePath = dir.filePath("save");
+                qint64 bytes = 0;
+                BenchSupport::Timing timing = BenchSupport::measure(runs, [&]() {
+                    QList<ImageProcessor::EncodeResult> encoded = processor.saveImage(basePath, QString(), source,
+                                                                                      {format});
+                    bytes = encoded.value(0).bytes;
+                });
+                record("save", ImageProcessor::getFormatInfo(format).extension, size, timing, bytes);
+            }
+            
+            if (!json) {
+                out << "\n" << BenchSupport::patternName(pattern) << " " << size.width() << "x" << size.height()
+                    << QString(" (%1 MP)\n").arg(size.width() * static_cast<double>(size.height()) / 1e6, 0, 'f', 1);
+                for (int i = first; i < results.size(); ++i) {
+                    const Result &result = results[i];
+                    out << QString("  %1 %2 %3 ms %4 ms %5 MP/s")
+                           .arg(result.stage, -13)
+                           .arg(result.variant, -10)
+                           .arg(result.timing.medianMs, 9, 'f', 1)
+                           .arg(result.timing.p95Ms, 9, 'f', 1)
+                           .arg(result.megapixelsPerSecond, 8, 'f', 1);
+                    if (result.bytes >= 0) {
+                        out << QString(" %1 KB").arg(result.bytes / 1024, 8);
+                    }
+                    out << "\n";
+                }
+                out.flush();
+            }
+        }
+    }
+    
+    if (json) {
+        QJsonArray array;
+        for (const Result &result : results) {
+            array.append(toJson(result));
+        }
+        QJsonObject document;
+        document["version"] = QCoreApplication::applicationVersion();
+        document["qt"] = QString(qVersion());
+        document["kernels"] = PixelKernels::isaName(PixelKernels::activeIsa());
+        document["threads"] = ParallelFor::threadCount();
+        document["runs"] = runs;
+        document["results"] = array;
+        out << QJsonDocument(document).toJson(QJsonDocument::Indented);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,74 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "BenchSupport.h"
+#include "Resampler.h"
+#include "PixelKernels.h"
+#include "ParallelFor.h"
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QImage>
+
+// Compares the Qt copy + scaled() path against Resampler for the export
+// sizes we care about. Usage: resampler_bench [runs]
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    
+    int runs = 7;
+    if (app.arguments().size() > 1) {
+        runs = qMax(1, app.arguments().at(1).toInt());
+    }
+    
+    struct Case {
+        QString name;
+        QSize source;
+        QSize target;
+    };
+    const QList<Case> cases = {
+        {"8K -> 1080p", QSize(7680, 4320), QSize(1920, 1080)},
+        {"1080p -> 4K", QSize(1920, 1080), QSize(3840, 2160)},
+    };
+    
+    out << "Kernels: " << PixelKernels::isaName(PixelKernels::activeIsa())
+        << ", threads: " << ParallelFor::threadCount() << ", median of " << runs << " runs\n";
+    
+    for (const Case &c : cases) {
+        const QImage source = BenchSupport::syntheticImage(BenchSupport::Pattern::Photo, c.source.width(),
+                                                           c.source.height());
+        const QRect cropRect = source.rect();
+        const double megapixels = c.source.width() * c.source.height() / 1e6;
+        
+        out << "\n" << c.name << "\n";
+        
+        double qtMs = BenchSupport::measure(runs, [&]() {
+            QImage result = source.copy(cropRect).scaled(c.target, Qt::IgnoreAspectRatio,
+                                                         Qt::SmoothTransformation);
+            Q_UNUSED(result);
+        }).medianMs;
+        out << QString("  %1 %2 ms  %3 MP/s\n")
+               .arg("Qt copy + scaled", -18)
+               .arg(qtMs, 8, 'f', 1)
+               .arg(megapixels / (qtMs / 1000.0), 7, 'f', 1);
+        
+        for (Resampler::Filter filter : {Resampler::Filter::Box, Resampler::Filter::Mitchell,
+                                         Resampler::Filter::Lanczos3}) {
+            double ms = BenchSupport::measure(runs, [&]() {
+                QImage result = Resampler::resample(source, QRectF(cropRect), c.target, filter);
+                Q_UNUSED(result);
+            }).medianMs;
+            out << QString("  %1 %2 ms  %3 MP/s  %4x\n")
+                   .arg("Resampler " + Resampler::filterName(filter), -18)
+                   .arg(ms, 8, 'f', 1)
+                   .arg(megapixels / (ms / 1000.0), 7, 'f', 1)
+                   .arg(qtMs / ms, 0, 'f', 2);
+        }
+    }
+    
+    return 0;
+}
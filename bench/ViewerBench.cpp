@@ -0,0 +1,260 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "BenchSupport.h"
+#include "ImageProcessor.h"
+#include "ImageViewer.h"
+#include <QApplication>
+#include <QTextStream>
+#include <QTemporaryDir>
+#include <QImageWriter>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QThreadPool>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// Responsiveness of the GUI thread and paint cost of the viewer. Runs without a display through the
+// offscreen platform, e.g. QT_QPA_PLATFORM=offscreen viewer_bench load.
+//
+//   viewer_bench load [image]  Event loop gaps while the image decodes in
+//                              the background, against the time a decode
+//                              on the GUI thread would block it. Without an
+//                              image, a ~100 MB uncompressed TIFF is written.
+//                              Fails if any gap misses a 60 Hz frame.
+//   viewer_bench pan [WxH]     Paint time per frame while panning a 1920x1080
+//                              viewer across a synthetic image (default
+//                              15360x8640) at 1:1, 50% and fit to window.
+//                              Fails if the p95 warm frame at any zoom takes
+//                              longer than one 60 Hz frame.
+
+namespace {
+
+const int kFrameMs = 16; // One 60 Hz frame, rounded down
+const double kFrameBudgetMs = 1000.0 / 60;
+
+struct Timings {
+    double medianMs;
+    double p95Ms;
+    double maxMs;
+    int frames;
+    int late;               // Over 1.5 frames, i.e. a missed frame at 60 Hz
+};
+
+Timings summarize(std::vector<double> samples)
+{
+    Timings result = {0, 0, 0, 0, 0};
+    if (samples.empty()) {
+        return result;
+    }
+    std::sort(samples.begin(), samples.end());
+    result.medianMs = samples[samples.size() / 2];
+    result.p95Ms = samples[std::min(samples.size() - 1, static_cast<size_t>(0.95 * samples.size()))];
+    result.maxMs = samples.back();
+    result.frames = static_cast<int>(samples.size());
+    result.late = static_cast<int>(std::count_if(samples.begin(), samples.end(), [](double sample) {
+        return sample > kFrameMs * 1.5;
+    }));
+    return result;
+}
+
+QString describe(const Timings &timings)
+{
+    return QString("%1 frames, median %2 ms, p95 %3 ms, max %4 ms, %5 late")
+           .arg(timings.frames)
+           .arg(timings.medianMs, 0, 'f', 1)
+           .arg(timings.p95Ms, 0, 'f', 1)
+           .arg(timings.maxMs, 0, 'f', 1)
+           .arg(timings.late);
+}
+
+int runLoad(const QStringList &arguments, QTextStream &out, QTextStream &err)
+{
+    QTemporaryDir dir;
+    QString path = arguments.value(0);
+    if (path.isEmpty()) {
+        // 5200x5000 RGB32 without compression is about 100 MB on disk
+        path = dir.filePath("large.tif");
+        QImageWriter writer(path, "tiff");
+        writer.setCompression(0);
+        if (!writer.write(BenchSupport::syntheticImage(BenchSupport::Pattern::Photo, 5200, 5000))) {
+            err << "Cannot write " << path << ": " << writer.errorString() << "\n";
+            return 1;
+        }
+    }
+    out << QString("%1: %2 MB\n").arg(QFileInfo(path).fileName())
+           .arg(QFileInfo(path).size() / (1024.0 * 1024.0), 0, 'f', 1);
+    
+    // What the GUI thread used to do: decode in place
+    QElapsedTimer blocking;
+    blocking.start();
+    const QImage image = ImageProcessor::decodeImage(path);
+    out << QString("  decode on the GUI thread blocks it for %1 ms\n").arg(blocking.elapsed());
+    if (image.isNull()) {
+        err << "Cannot decode " << path << "\n";
+        return 1;
+    }
+    
+    // The asynchronous load, with a 60 Hz timer standing in for repaints
+    ImageProcessor processor;
+    processor.setDecodeCacheMB(0);
+    processor.setProxyCacheMB(0);
+    std::vector<double> gaps;
+    QElapsedTimer clock;
+    qint64 last = 0;
+    QTimer frame;
+    frame.setTimerType(Qt::PreciseTimer);
+    frame.setInterval(kFrameMs);
+    QObject::connect(&frame, &QTimer::timeout, [&]() {
+        const qint64 now = clock.nsecsElapsed();
+        gaps.push_back((now - last) / 1e6);
+        last = now;
+    });
+    
+    QEventLoop loop;
+    QString error;
+    QObject::connect(&processor, &ImageProcessor::imageLoaded, &loop, &QEventLoop::quit);
+    QObject::connect(&processor, &ImageProcessor::loadFailed, [&](const QString &, const QString &message) {
+        error = message;
+        loop.quit();
+    });
+    
+    clock.start();
+    frame.start();
+    if (processor.loadImage(path)) {
+        loop.exec();
+    }
+    const qint64 loadMs = clock.elapsed();
+    frame.stop();
+    if (!error.isEmpty()) {
+        err << error << "\n";
+        return 1;
+    }
+    
+    const Timings timings = summarize(gaps);
+    out << QString("  background load takes %1 ms; GUI thread gaps: %2\n").arg(loadMs).arg(describe(timings));
+    if (timings.late > 0) {
+        out << QString("  FAILED, the GUI thread missed %1 frame(s) at 60 Hz during the load\n").arg(timings.late);
+        return 1;
+    }
+    return 0;
+}
+
+struct Frames {
+    std::vector<double> paintMs;  // ImageViewer's own measure of each repaint
+    std::vector<double> frameMs;  // Repaint plus event processing
+};
+
+// Centres the view on points along the image's diagonal, one step per frame
+Frames pan(ImageViewer &viewer, const QSize &imageSize, int frames)
+{
+    Frames result;
+    QElapsedTimer clock;
+    for (int frame = 0; frame < frames; ++frame) {
+        const qreal t = 0.25 + 0.5 * frame / qMax(1, frames - 1);
+        clock.start();
+        viewer.centerOn(imageSize.width() * t, imageSize.height() * t);
+        viewer.viewport()->repaint();
+        QCoreApplication::processEvents();
+        result.frameMs.push_back(clock.nsecsElapsed() / 1e6);
+        result.paintMs.push_back(viewer.lastFrameMs());
+    }
+    return result;
+}
+
+// Lets the pyramid levels the current zoom needs finish building
+void settle(ImageViewer &viewer)
+{
+    for (int i = 0; i < 4; ++i) {
+        viewer.viewport()->repaint();
+        QThreadPool::globalInstance()->waitForDone();
+        QCoreApplication::processEvents();
+    }
+}
+
+int runPan(const QStringList &arguments, QTextStream &out, QTextStream &err)
+{
+    QSize size(15360, 8640);
+    if (!arguments.isEmpty()) {
+        const QStringList parts = arguments.first().split('x');
+        size = parts.size() == 2 ? QSize(parts[0].toInt(), parts[1].toInt()) : QSize();
+        if (size.isEmpty()) {
+            err << "Expected a size such as 15360x8640\n";
+            return 2;
+        }
+    }
+    
+    const int frames = 120;
+    const QImage image = BenchSupport::syntheticImage(BenchSupport::Pattern::Photo, size.width(), size.height());
+    ImageViewer viewer;
+    viewer.resize(1920, 1080);
+    viewer.show();
+    viewer.setImage(image);
+    QCoreApplication::processEvents();
+    out << QString("%1x%2 in a %3x%4 viewport, %5 frames per pass (%6)\n")
+           .arg(size.width()).arg(size.height())
+           .arg(viewer.viewport()->width()).arg(viewer.viewport()->height())
+           .arg(frames).arg(QGuiApplication::platformName());
+    
+    struct Zoom {
+        const char *name;
+        std::function<void()> apply;
+    };
+    const QList<Zoom> zooms = {
+        {"1:1", [&]() { viewer.actualSize(); }},
+        {"50%", [&]() { viewer.actualSize(); viewer.setZoomFactor(0.5); }},
+        {"fit", [&]() { viewer.fitToWindow(); }},
+    };
+    bool smooth = true;
+    for (const Zoom &zoom : zooms) {
+        zoom.apply();
+        // The first pass includes building levels and uploading tiles; the
+        // second shows panning over a warm tile cache
+        const Frames cold = pan(viewer, size, frames);
+        settle(viewer);
+        const Frames warm = pan(viewer, size, frames);
+        out << QString("  %1 cold: paint %2\n").arg(zoom.name, -4).arg(describe(summarize(cold.paintMs)));
+        out << QString("  %1 cold: frame %2\n").arg(zoom.name, -4).arg(describe(summarize(cold.frameMs)));
+        out << QString("  %1 warm: paint %2\n").arg(zoom.name, -4).arg(describe(summarize(warm.paintMs)));
+        const Timings warmFrames = summarize(warm.frameMs);
+        out << QString("  %1 warm: frame %2\n").arg(zoom.name, -4).arg(describe(warmFrames));
+        out << QString("  %1 pyramid %2 MB, tile cache %3 MB\n").arg(zoom.name, -4)
+               .arg(viewer.pyramidBytes() / (1024.0 * 1024.0), 0, 'f', 1)
+               .arg(viewer.tileCacheBytes() / (1024.0 * 1024.0), 0, 'f', 1);
+        
+        // Cold passes include building levels and uploading tiles, so only
+        // panning over a warm cache has to keep up with the display
+        if (warmFrames.p95Ms > kFrameBudgetMs) {
+            out << QString("  %1 FAILED, p95 warm frame over %2 ms\n").arg(zoom.name, -4)
+                   .arg(kFrameBudgetMs, 0, 'f', 1);
+            smooth = false;
+        }
+    }
+    return smooth ? 0 : 1;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    QStringList arguments = app.arguments().mid(1);
+    const QString mode = arguments.isEmpty() ? QString() : arguments.takeFirst();
+    if (mode == "load") {
+        return runLoad(arguments, out, err);
+    }
+    if (mode == "pan") {
+        return runPan(arguments, out, err);
+    }
+    
+    err << "Usage: viewer_bench load [image] | pan [WxH]\n";
+    return 2;
+}
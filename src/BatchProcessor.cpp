@@ -0,0 +1,474 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "BatchProcessor.h"
+#include "ParallelFor.h"
+#include "Trace.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QTextStream>
+#include <QRegularExpression>
+#include <QImageReader>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+const char *BatchProcessor::BatchOption = "--batch";
+
+bool BatchProcessor::isBatchInvocation(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], BatchOption) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 BatchProcessor::peakMemoryKB()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_MACOS
+        return usage.ru_maxrss / 1024; // Bytes on macOS
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+bool BatchProcessor::parseResolution(const QString &text, QSize *size)
+{
+    // Accept either a resolution name ("QHD") or its dimensions ("2560x1440")
+    static const QRegularExpression dimensions("^(\\d+)[xX](\\d+)$");
+    QRegularExpressionMatch match = dimensions.match(text.trimmed());
+    
+    for (const ImageProcessor::Resolution &resolution : ImageProcessor::getSupportedResolutions()) {
+        bool matches = match.hasMatch()
+            ? (match.captured(1).toInt() == resolution.width && match.captured(2).toInt() == resolution.height)
+            : (resolution.name.compare(text.trimmed(), Qt::CaseInsensitive) == 0);
+        if (matches) {
+            *size = QSize(resolution.width, resolution.height);
+            return true;
+        }
+    }
+    return false;
+}
+
+QStringList BatchProcessor::collectInputs(const QStringList &paths, QStringList *errors)
+{
+    QStringList nameFilters;
+    for (const QString &extension : ImageProcessor::getSupportedInputExtensions()) {
+        nameFilters << QString("*.%1").arg(extension) << QString("*.%1").arg(extension.toUpper());
+    }
+    
+    QStringList inputs;
+    for (const QString &path : paths) {
+        QFileInfo info(path);
+        if (info.isDir()) {
+            // Directories are scanned one level deep, in name order
+            QDir dir(info.absoluteFilePath());
+            for (const QFileInfo &entry : dir.entryInfoList(nameFilters, QDir::Files, QDir::Name)) {
+                inputs << entry.absoluteFilePath();
+            }
+        } else if (info.isFile()) {
+            inputs << info.absoluteFilePath();
+        } else {
+            errors->append(QString("No such file or directory: %1").arg(path));
+        }
+    }
+    
+    inputs.removeDuplicates();
+    return inputs;
+}
+
+int BatchProcessor::run(const QStringList &arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Render wallpapers from images without opening the GUI.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    
+    QCommandLineOption batchOption("batch", "Run in headless batch mode.");
+    QCommandLineOption resolutionOption(QStringList() << "r" << "resolution",
+        "Target resolution, as a name or WIDTHxHEIGHT from --list-resolutions. Repeatable.",
+        "resolution");
+    QCommandLineOption listOption("list-resolutions", "List the supported resolutions and exit.");
+    QCommandLineOption formatOption(QStringList() << "f" << "format",
+        "Output formats, comma separated: png, jpg, bmp, tiff or webp. Defaults to the format of each input.",
+        "formats");
+    QCommandLineOption qualityOption(QStringList() << "q" << "quality",
+        "JPEG and WebP quality, 1-100.", "quality", "85");
+    QCommandLineOption maxSizeOption("max-size",
+        "Largest JPEG or WebP file in KB; the quality is lowered until it fits.", "kilobytes");
+    QCommandLineOption speedOption("speed",
+        "Encoder effort for PNG, JPEG and TIFF: fast, balanced or smallest.", "speed", "balanced");
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+        "Output directory. Defaults to the directory of each input.", "directory");
+    QCommandLineOption fullDecodeOption("full-decode",
+        "Decode whole images instead of just the cropped area at the needed resolution.");
+    QCommandLineOption traceOption("trace",
+        QString("Write a Chrome trace of the run to file (or set %1).").arg(Trace::EnvironmentVariable), "file");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+        "Number of images processed at once. Defaults to one per hardware thread.", "count");
+    
+    parser.addOption(batchOption);
+    parser.addOption(resolutionOption);
+    parser.addOption(listOption);
+    parser.addOption(formatOption);
+    parser.addOption(qualityOption);
+    parser.addOption(maxSizeOption);
+    parser.addOption(speedOption);
+    parser.addOption(outputOption);
+    parser.addOption(jobsOption);
+    parser.addOption(fullDecodeOption);
+    parser.addOption(traceOption);
+    parser.addPositionalArgument("inputs", "Image files or directories to process.", "[inputs...]");
+    
+    parser.process(arguments);
+    Trace::startFromArguments(arguments);
+    
+    if (parser.isSet(listOption)) {
+        for (const ImageProcessor::Resolution &resolution : ImageProcessor::getSupportedResolutions()) {
+            out << QString("%1x%2").arg(resolution.width).arg(resolution.height).leftJustified(12)
+                << resolution.name << "\n";
+        }
+        return EXIT_SUCCESS;
+    }
+    
+    // Resolutions
+    QList<QSize> sizes;
+    for (const QString &value : parser.values(resolutionOption)) {
+        QSize size;
+        if (!parseResolution(value, &size)) {
+            err << "Unsupported resolution: " << value << " (see --list-resolutions)\n";
+            return EXIT_FAILURE;
+        }
+        if (!sizes.contains(size)) {
+            sizes << size;
+        }
+    }
+    if (sizes.isEmpty()) {
+        err << "At least one --resolution is required\n";
+        return EXIT_FAILURE;
+    }
+    
+    // Output formats, each rendered image is encoded to all of them
+    QMap<QString, ImageProcessor::OutputFormat> mapping = ImageProcessor::getDefaultOutputMapping();
+    bool forceFormat = parser.isSet(formatOption);
+    QList<ImageProcessor::OutputFormat> formats;
+    if (forceFormat) {
+        for (const QString &value : parser.value(formatOption).toLower().split(',', Qt::SkipEmptyParts)) {
+            QString name = value.trimmed();
+            if (!mapping.contains(name) || !ImageProcessor::isOutputFormatAvailable(mapping.value(name))) {
+                err << "Unsupported output format: " << name << "\n";
+                return EXIT_FAILURE;
+            }
+            if (!formats.contains(mapping.value(name))) {
+                formats << mapping.value(name);
+            }
+        }
+        if (formats.isEmpty()) {
+            err << "At least one output format is required\n";
+            return EXIT_FAILURE;
+        }
+    }
+    
+    bool ok = false;
+    ImageProcessor::EncodeOptions encodeOptions;
+    encodeOptions.quality = parser.value(qualityOption).toInt(&ok);
+    if (!ok || encodeOptions.quality < 1 || encodeOptions.quality > 100) {
+        err << "Quality must be between 1 and 100\n";
+        return EXIT_FAILURE;
+    }
+    
+    encodeOptions.maxFileBytes = 0;
+    if (parser.isSet(maxSizeOption)) {
+        int kilobytes = parser.value(maxSizeOption).toInt(&ok);
+        if (!ok || kilobytes < 1) {
+            err << "Max size must be a positive number of KB\n";
+            return EXIT_FAILURE;
+        }
+        encodeOptions.maxFileBytes = static_cast<qint64>(kilobytes) * 1024;
+    }
+    
+    QMap<QString, ImageProcessor::EncoderSpeed> speedNames = {
+        {"fast", ImageProcessor::EncoderSpeed::Fast},
+        {"balanced", ImageProcessor::EncoderSpeed::Balanced},
+        {"smallest", ImageProcessor::EncoderSpeed::Smallest}
+    };
+    QString speedName = parser.value(speedOption).toLower();
+    if (!speedNames.contains(speedName)) {
+        err << "Speed must be fast, balanced or smallest\n";
+        return EXIT_FAILURE;
+    }
+    for (ImageProcessor::OutputFormat format : ImageProcessor::getAvailableOutputFormats()) {
+        encodeOptions.speeds.insert(format, speedNames.value(speedName));
+    }
+    
+    int jobs = QThread::idealThreadCount();
+    if (parser.isSet(jobsOption)) {
+        jobs = parser.value(jobsOption).toInt(&ok);
+        if (!ok || jobs < 1) {
+            err << "Jobs must be a positive number\n";
+            return EXIT_FAILURE;
+        }
+    }
+    
+    const bool fullDecode = parser.isSet(fullDecodeOption);
+    
+    QString outputDir;
+    if (parser.isSet(outputOption)) {
+        outputDir = QDir(parser.value(outputOption)).absolutePath();
+        if (!QDir().mkpath(outputDir)) {
+            err << "Cannot create output directory: " << outputDir << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    
+    // Inputs
+    QStringList errors;
+    QStringList inputs = collectInputs(parser.positionalArguments(), &errors);
+    for (const QString &error : errors) {
+        err << error << "\n";
+    }
+    if (inputs.isEmpty()) {
+        err << "No input images\n";
+        return EXIT_FAILURE;
+    }
+    
+    // Output paths are resolved here, on the main thread, since they read
+    // the shared format tables
+    QList<Job> queue;
+    for (const QString &input : inputs) {
+        QFileInfo info(input);
+        Job job;
+        job.inputPath = input;
+        job.sizes = sizes;
+        if (forceFormat) {
+            job.formats = formats;
+        } else {
+            job.formats << mapping.value(info.suffix().toLower(), ImageProcessor::OutputFormat::PNG);
+        }
+        
+        QString basePath = outputDir.isEmpty() ? input : QDir(outputDir).filePath(info.fileName());
+        for (const QSize &size : sizes) {
+            QString suffix = QString("_%1x%2").arg(size.width()).arg(size.height());
+            for (ImageProcessor::OutputFormat format : job.formats) {
+                job.outputPaths << ImageProcessor::outputFilePath(basePath, suffix, format);
+            }
+        }
+        queue << job;
+    }
+    
+    // Inputs that differ only in extension, or in a directory when writing
+    // to --output, map to the same names; refuse rather than overwrite
+    QHash<QString, QString> outputOwners;
+    for (const QString &input : inputs) {
+        outputOwners.insert(input, input);
+    }
+    QStringList conflicts;
+    for (const Job &job : queue) {
+        for (const QString &outputPath : job.outputPaths) {
+            auto owner = outputOwners.constFind(outputPath);
+            if (owner == outputOwners.constEnd()) {
+                outputOwners.insert(outputPath, job.inputPath);
+            } else if (owner.value() != job.inputPath) {
+                conflicts << QString("%1 would be written from both %2 and %3")
+                             .arg(outputPath, owner.value(), job.inputPath);
+            }
+        }
+    }
+    if (!conflicts.isEmpty()) {
+        for (const QString &conflict : conflicts) {
+            err << conflict << "\n";
+        }
+        err << "Output names clash; rename the inputs or process them separately\n";
+        return EXIT_FAILURE;
+    }
+    
+    // Files are the unit of parallelism; the per-image kernels share what is
+    // left of the cores so the two levels do not oversubscribe the machine
+    jobs = qMin(jobs, static_cast<int>(queue.size()));
+    int previousMaxThreads = ParallelFor::maxThreadCount();
+    ParallelFor::setMaxThreadCount(qMax(1, QThread::idealThreadCount() / jobs));
+    
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+    
+    QMutex outputMutex;
+    std::atomic<int> failures(0);
+    std::atomic<qint64> sourcePixels(0);
+    std::atomic<int> outputsWritten(0);
+    
+    out << "Processing " << queue.size() << " image(s) at " << sizes.size()
+        << " resolution(s) with " << jobs << " job(s)\n";
+    out.flush();
+    
+    // Memory per job for files streamed in strips, as in the GUI by default
+    const qint64 streamBudget = static_cast<qint64>(ImageProcessor::DefaultMemoryBudgetMB) * 1024 * 1024;
+    
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+    
+    for (const Job &job : queue) {
+        pool.start([&, job]() {
+            TRACE_SCOPE("BatchProcessor::job");
+            QElapsedTimer timer;
+            timer.start();
+            
+            QString error;
+            QSize sourceSize = QImageReader(job.inputPath).size();
+            QImage image;
+            QRect decodedRect;
+            
+            if (fullDecode || !sourceSize.isValid()) {
+                image = ImageProcessor::decodeImage(job.inputPath, &error);
+                sourceSize = image.size();
+                decodedRect = image.rect();
+            } else {
+                // Decode only the union of the crops, at the smallest
+                // resolution that still covers the largest output
+                QRect area;
+                double scale = 0.0;
+                for (const QSize &size : job.sizes) {
+                    QRect cropRect = ImageProcessor::centerCropRect(sourceSize, size);
+                    area = area.united(cropRect);
+                    scale = qMax(scale, qMax(static_cast<double>(size.width()) / cropRect.width(),
+                                             static_cast<double>(size.height()) / cropRect.height()));
+                }
+                QSize minimumSize(static_cast<int>(std::ceil(area.width() * scale)),
+                                  static_cast<int>(std::ceil(area.height() * scale)));
+                image = ImageProcessor::decodeRegion(job.inputPath, area, minimumSize, &decodedRect, &error);
+            }
+            
+            // Qt refuses whole decodes over its allocation limit; those files
+            // are resampled from strips instead, one output at a time
+            const bool streamed = image.isNull() && sourceSize.isValid()
+                                  && ImageProcessor::exceedsReaderAllocationLimit(
+                                         sourceSize, QImageReader(job.inputPath).imageFormat());
+            if (streamed) {
+                error.clear();
+            }
+            qint64 decodeMs = timer.restart();
+            
+            qint64 renderMs = 0;
+            qint64 encodeMs = 0;
+            QList<ImageProcessor::EncodeResult> encodes;
+            int written = 0;
+            
+            if (!image.isNull() || streamed) {
+                for (int i = 0; i < job.sizes.size() && error.isEmpty(); ++i) {
+                    const QSize &size = job.sizes[i];
+                    QRect cropRect = ImageProcessor::centerCropRect(sourceSize, size);
+                    QImage rendered;
+                    if (streamed) {
+                        rendered = ImageProcessor::streamResample(job.inputPath, QRectF(cropRect), size,
+                                                                  Resampler::Filter::Lanczos3, streamBudget,
+                                                                  &error);
+                    } else {
+                        const double sx = static_cast<double>(image.width()) / decodedRect.width();
+                        const double sy = static_cast<double>(image.height()) / decodedRect.height();
+                        QRectF mapped((cropRect.x() - decodedRect.x()) * sx, (cropRect.y() - decodedRect.y()) * sy,
+                                      cropRect.width() * sx, cropRect.height() * sy);
+                        rendered = Resampler::resample(image, mapped, size);
+                    }
+                    renderMs += timer.restart();
+                    if (rendered.isNull()) {
+                        if (error.isEmpty()) {
+                            error = QString("Failed to render %1x%2").arg(size.width()).arg(size.height());
+                        }
+                        break;
+                    }
+                    
+                    // Files already run in parallel, so the formats of one
+                    // file are encoded in turn from the same rendered image
+                    for (int f = 0; f < job.formats.size() && error.isEmpty(); ++f) {
+                        ImageProcessor::EncodeTask task{rendered, job.outputPaths[i * job.formats.size() + f],
+                                                        job.formats[f]};
+                        ImageProcessor::EncodeResult result = ImageProcessor::encodeFile(task, encodeOptions);
+                        if (result.error.isEmpty()) {
+                            ++written;
+                        } else {
+                            error = result.error;
+                        }
+                        encodes << result;
+                        encodeMs += timer.restart();
+                    }
+                }
+            }
+            
+            outputsWritten += written;
+            if (error.isEmpty()) {
+                // Throughput counts only the images that were fully written
+                sourcePixels += static_cast<qint64>(sourceSize.width()) * sourceSize.height();
+            }
+            
+            QMutexLocker locker(&outputMutex);
+            QString name = QFileInfo(job.inputPath).fileName();
+            if (error.isEmpty()) {
+                const QString decoded = streamed ? QString("streamed")
+                                                 : QString("decoded %1x%2").arg(image.width()).arg(image.height());
+                out << QString("%1  %2x%3 (%4)  decode %5 ms  render %6 ms  encode %7 ms\n")
+                       .arg(name)
+                       .arg(sourceSize.width())
+                       .arg(sourceSize.height())
+                       .arg(decoded)
+                       .arg(decodeMs)
+                       .arg(renderMs)
+                       .arg(encodeMs);
+                if (job.formats.size() > 1 || encodeOptions.maxFileBytes > 0) {
+                    out << QString("    %1\n").arg(ImageProcessor::encodeSummary(encodes));
+                }
+                out.flush();
+            } else {
+                ++failures;
+                err << QString("%1  failed: %2\n").arg(name, error);
+                err.flush();
+            }
+        });
+    }
+    
+    pool.waitForDone();
+    qint64 totalMs = qMax<qint64>(1, totalTimer.elapsed());
+    ParallelFor::setMaxThreadCount(previousMaxThreads);
+    
+    double seconds = totalMs / 1000.0;
+    int succeeded = queue.size() - failures;
+    out << QString("%1 of %2 image(s), %3 output(s) in %4 s: %5 images/s, %6 MP/s\n")
+           .arg(succeeded)
+           .arg(queue.size())
+           .arg(outputsWritten.load())
+           .arg(seconds, 0, 'f', 2)
+           .arg(succeeded / seconds, 0, 'f', 2)
+           .arg(sourcePixels / 1e6 / seconds, 0, 'f', 1);
+    
+    qint64 peakKB = peakMemoryKB();
+    if (peakKB > 0) {
+        out << QString("Peak memory: %1 MB\n").arg(peakKB / 1024.0, 0, 'f', 1);
+    }
+    
+    return (failures == 0 && errors.isEmpty()) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,44 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include "ImageProcessor.h"
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSize>
+
+// Headless command-line mode. Renders every input image at each requested
+// resolution with a centered crop, processing files in parallel, and prints
+// per-file timings followed by the aggregate throughput.
+class BatchProcessor
+{
+public:
+    static const char *BatchOption;
+    
+    // True if the process was started with --batch; checked before any
+    // application object exists so no GUI is created in batch mode
+    static bool isBatchInvocation(int argc, char *argv[]);
+    
+    // Parses the arguments, processes the inputs and returns the exit code
+    static int run(const QStringList &arguments);
+
+private:
+    struct Job {
+        QString inputPath;
+        QList<QSize> sizes;
+        QList<ImageProcessor::OutputFormat> formats;
+        QStringList outputPaths; // Per size, then per format
+    };
+    
+    static qint64 peakMemoryKB(); // Peak resident set size, 0 if unknown
+    static bool parseResolution(const QString &text, QSize *size);
+    static QStringList collectInputs(const QStringList &paths, QStringList *errors);
+};
+
+#endif // BATCHPROCESSOR_H
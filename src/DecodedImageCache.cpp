@@ -0,0 +1,164 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "DecodedImageCache.h"
+#include <QMutexLocker>
+#include <QFileInfo>
+#include <QDateTime>
+
+DecodedImageCache::DecodedImageCache(qint64 budgetBytes)
+    : m_bytes(0)
+    , m_budget(budgetBytes)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+void DecodedImageCache::setBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_budget = qMax<qint64>(0, bytes);
+    evict();
+}
+
+qint64 DecodedImageCache::budget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_budget;
+}
+
+bool DecodedImageCache::lookup(const QString &filePath, Entry *entry)
+{
+    QString key;
+    qint64 modified = 0;
+    qint64 fileSize = 0;
+    const bool exists = fileStamp(filePath, &key, &modified, &fileSize);
+    
+    QMutexLocker locker(&m_mutex);
+    auto it = m_items.find(key);
+    if (it == m_items.end()) {
+        ++m_misses;
+        return false;
+    }
+    
+    // The file changed since it was decoded
+    if (!exists || it->modified != modified || it->fileSize != fileSize) {
+        m_bytes -= entryBytes(it->entry);
+        m_items.erase(it);
+        m_order.removeOne(key);
+        ++m_misses;
+        return false;
+    }
+    
+    m_order.removeOne(key);
+    m_order.append(key);
+    *entry = it->entry;
+    ++m_hits;
+    return true;
+}
+
+bool DecodedImageCache::contains(const QString &filePath) const
+{
+    QString key;
+    qint64 modified = 0;
+    qint64 fileSize = 0;
+    if (!fileStamp(filePath, &key, &modified, &fileSize)) {
+        return false;
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    auto it = m_items.constFind(key);
+    return it != m_items.constEnd() && it->modified == modified && it->fileSize == fileSize;
+}
+
+void DecodedImageCache::insert(const QString &filePath, const Entry &entry)
+{
+    QString key;
+    qint64 modified = 0;
+    qint64 fileSize = 0;
+    if (!fileStamp(filePath, &key, &modified, &fileSize) || entry.image.isNull()) {
+        return;
+    }
+    
+    const qint64 bytes = entryBytes(entry);
+    QMutexLocker locker(&m_mutex);
+    if (bytes > m_budget) {
+        return; // Would only evict everything else
+    }
+    
+    auto it = m_items.find(key);
+    if (it != m_items.end()) {
+        m_bytes -= entryBytes(it->entry);
+        m_order.removeOne(key);
+    }
+    m_items.insert(key, {entry, modified, fileSize});
+    m_order.append(key);
+    m_bytes += bytes;
+    evict();
+}
+
+void DecodedImageCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_items.clear();
+    m_order.clear();
+    m_bytes = 0;
+}
+
+DecodedImageCache::Stats DecodedImageCache::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return {m_hits, m_misses, m_bytes, static_cast<int>(m_items.size())};
+}
+
+qint64 DecodedImageCache::bytesExcluding(const QList<qint64> &cacheKeys) const
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 bytes = 0;
+    for (const Item &item : m_items) {
+        if (!cacheKeys.contains(item.entry.image.cacheKey())) {
+            bytes += item.entry.image.sizeInBytes();
+        }
+        if (item.entry.preview.cacheKey() != item.entry.image.cacheKey()
+            && !cacheKeys.contains(item.entry.preview.cacheKey())) {
+            bytes += item.entry.preview.sizeInBytes();
+        }
+    }
+    return bytes;
+}
+
+bool DecodedImageCache::fileStamp(const QString &filePath, QString *key, qint64 *modified, qint64 *fileSize)
+{
+    QFileInfo info(filePath);
+    *key = info.absoluteFilePath();
+    if (!info.exists()) {
+        return false;
+    }
+    *modified = info.lastModified().toMSecsSinceEpoch();
+    *fileSize = info.size();
+    return true;
+}
+
+qint64 DecodedImageCache::entryBytes(const Entry &entry)
+{
+    qint64 bytes = entry.image.sizeInBytes();
+    if (entry.preview.cacheKey() != entry.image.cacheKey()) {
+        bytes += entry.preview.sizeInBytes();
+    }
+    return bytes;
+}
+
+void DecodedImageCache::evict()
+{
+    while (m_bytes > m_budget && !m_order.isEmpty()) {
+        const QString key = m_order.takeFirst();
+        auto it = m_items.find(key);
+        if (it != m_items.end()) {
+            m_bytes -= entryBytes(it->entry);
+            m_items.erase(it);
+        }
+    }
+}
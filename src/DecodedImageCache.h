@@ -0,0 +1,73 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef DECODEDIMAGECACHE_H
+#define DECODEDIMAGECACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+
+// Recently decoded images, so reopening a file skips the decode. Entries
+// are found by path and only used while the file's modification time and
+// size still match. The least recently used entries are evicted once the
+// cache holds more than its budget. Safe to use from any thread.
+class DecodedImageCache
+{
+public:
+    struct Entry {
+        QImage image;         // Full decode, or the proxy of a streamed image
+        QImage preview;       // May share image
+        QSize sourceSize;
+    };
+    
+    struct Stats {
+        qint64 hits;
+        qint64 misses;
+        qint64 bytes;
+        int entries;
+    };
+    
+    explicit DecodedImageCache(qint64 budgetBytes = 0);
+    
+    void setBudget(qint64 bytes); // 0 disables the cache
+    qint64 budget() const;
+    
+    // Counts a hit or miss; a stale entry is dropped and counts as a miss
+    bool lookup(const QString &filePath, Entry *entry);
+    bool contains(const QString &filePath) const; // A current entry exists; not counted
+    void insert(const QString &filePath, const Entry &entry);
+    void clear();
+    
+    Stats stats() const;
+    // Bytes held by entries whose pixels are not in cacheKeys, i.e. beyond
+    // the images the caller already accounts for
+    qint64 bytesExcluding(const QList<qint64> &cacheKeys) const;
+
+private:
+    struct Item {
+        Entry entry;
+        qint64 modified;      // Milliseconds since the epoch
+        qint64 fileSize;
+    };
+    
+    mutable QMutex m_mutex;
+    QHash<QString, Item> m_items;
+    QList<QString> m_order;   // Least recently used first
+    qint64 m_bytes;
+    qint64 m_budget;
+    qint64 m_hits;
+    qint64 m_misses;
+    
+    static bool fileStamp(const QString &filePath, QString *key, qint64 *modified, qint64 *fileSize);
+    static qint64 entryBytes(const Entry &entry);
+    void evict(); // Called with m_mutex held
+};
+
+#endif // DECODEDIMAGECACHE_H
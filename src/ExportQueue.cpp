@@ -0,0 +1,89 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "ExportQueue.h"
+#include "Trace.h"
+#include <QMetaObject>
+#include <QtGlobal>
+
+ExportQueue::ExportQueue(QObject *parent)
+    : QObject(parent)
+    , m_queued(0)
+    , m_finished(0)
+{
+    // One job at a time keeps exports in order; each job parallelizes its
+    // own resampling and encoding
+    m_pool.setMaxThreadCount(1);
+}
+
+ExportQueue::~ExportQueue()
+{
+    // Let queued exports write their files; results posted back to this
+    // object are discarded along with it
+    m_pool.waitForDone();
+}
+
+void ExportQueue::enqueue(const Job &job)
+{
+    ++m_queued;
+    reportProgress(0.0);
+    
+    m_pool.start([this, job]() {
+        Progress progress = [this](double fraction) {
+            QMetaObject::invokeMethod(this, [this, fraction]() {
+                reportProgress(fraction);
+            }, Qt::QueuedConnection);
+        };
+        
+        Outcome outcome;
+        {
+            TRACE_SCOPE("ExportQueue::job");
+            outcome = job(progress);
+        }
+        QMetaObject::invokeMethod(this, [this, outcome]() {
+            finishJob(outcome);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ExportQueue::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+void ExportQueue::reportProgress(double fraction)
+{
+    if (m_queued == 0) {
+        return;
+    }
+    
+    // Jobs are equal shares of the bar; the running one fills its share
+    double done = m_finished + qBound(0.0, fraction, 1.0);
+    emit progressChanged(qRound(100.0 * done / m_queued));
+}
+
+void ExportQueue::finishJob(const Outcome &outcome)
+{
+    ++m_finished;
+    
+    for (const QString &error : outcome.errors) {
+        emit jobFailed(error);
+    }
+    if (!outcome.summary.isEmpty()) {
+        emit jobFinished(outcome.summary);
+    }
+    if (outcome.renderMs >= 0 || outcome.encodeMs >= 0) {
+        emit jobTimed(outcome.renderMs, outcome.encodeMs);
+    }
+    
+    if (m_finished == m_queued) {
+        m_queued = 0;
+        m_finished = 0;
+        emit idle();
+    } else {
+        reportProgress(0.0);
+    }
+}
@@ -0,0 +1,62 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef EXPORTQUEUE_H
+#define EXPORTQUEUE_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+// Runs export jobs one after another on a background thread. Jobs work from
+// data captured when they were queued, so the GUI can move on to the next
+// crop immediately. Progress covers every job queued since the queue was
+// last idle; signals are delivered on the thread that owns the queue.
+class ExportQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Outcome {
+        QString summary;     // One line describing what was written
+        QStringList errors;  // Empty on success
+        qint64 renderMs = -1; // Crop, resample and adjust, -1 if not reported
+        qint64 encodeMs = -1; // Encoding all of the job's files, -1 if not reported
+    };
+    
+    // Called from the worker with the fraction of the running job done
+    using Progress = std::function<void(double fraction)>;
+    using Job = std::function<Outcome(const Progress &progress)>;
+    
+    explicit ExportQueue(QObject *parent = nullptr);
+    ~ExportQueue() override;
+    
+    void enqueue(const Job &job);
+    int pendingCount() const { return m_queued - m_finished; }
+    bool isBusy() const { return pendingCount() > 0; }
+    
+    // Blocks until every queued job has run, e.g. before quitting
+    void waitForDone();
+
+signals:
+    void progressChanged(int percent);
+    void jobFinished(const QString &summary);
+    void jobFailed(const QString &error);
+    void jobTimed(qint64 renderMs, qint64 encodeMs);
+    void idle();
+
+private:
+    QThreadPool m_pool;
+    int m_queued;    // Since the queue was last idle
+    int m_finished;
+    
+    void reportProgress(double fraction);
+    void finishJob(const Outcome &outcome);
+};
+
+#endif // EXPORTQUEUE_H
@@ -5,38 +5,105 @@
 //  See the LICENSE file for full details
 //===========================================
 #include "ImageProcessor.h"
+#include "PixelKernels.h"
+#include "ParallelFor.h"
+#include "ScanlineReader.h"
+#include "Trace.h"
 #include <QFileInfo>
 #include <QImageReader>
 #include <QImageWriter>
+#include <QImageIOHandler>
 #include <QDir>
 #include <QDebug>
 #include <QColorSpace>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QBuffer>
+#include <QFile>
+#include <QThread>
+#include <QSemaphore>
+#include <QPair>
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
 
-// Static member initialization
-QList<ImageProcessor::Resolution> ImageProcessor::s_resolutions;
-QMap<ImageProcessor::OutputFormat, ImageProcessor::FormatInfo> ImageProcessor::s_outputFormats;
-QMap<QString, ImageProcessor::OutputFormat> ImageProcessor::s_defaultMapping;
+namespace {
+
+// Longest side of the image the live preview is rendered from
+const int kPreviewMaxDimension = 2560;
+
+// Slider changes within this window are coalesced into one preview
+const int kPreviewIntervalMs = 30;
+
+// Longest side of the proxy shown for images over the memory budget
+const int kProxyMaxDimension = 8192;
+
+qint64 imageBytes(const QSize &size)
+{
+    return 4LL * size.width() * size.height();
+}
+
+} // namespace
 
 ImageProcessor::ImageProcessor(QObject *parent)
     : QObject(parent)
+    , m_streaming(false)
+    , m_memoryBudget(static_cast<qint64>(DefaultMemoryBudgetMB) * 1024 * 1024)
+    , m_loadPool(nullptr)
+    , m_loadGeneration(0)
+    , m_loading(false)
+    , m_decodeCache(static_cast<qint64>(DefaultDecodeCacheMB) * 1024 * 1024)
+    , m_proxyCache(static_cast<qint64>(DefaultProxyCacheMB) * 1024 * 1024)
+    , m_prefetchPool(nullptr)
+    , m_prefetchGeneration(0)
+    , m_prefetchMemory(static_cast<qint64>(DefaultPrefetchMemoryMB) * 1024 * 1024)
+    , m_prefetchAdopter(0)
+    , m_previewTimer(nullptr)
+    , m_previewPool(nullptr)
+    , m_previewGeneration(0)
     , m_brightness(0)
     , m_contrast(0)
     , m_saturation(0)
     , m_outputFormat(OutputFormat::PNG)
     , m_jpegQuality(85)
+    , m_maxFileSizeKB(0)
+    , m_exportQueue(nullptr)
+    , m_performance{-1, -1, -1, -1}
 {
-    initializeStaticData();
 }
 
-void ImageProcessor::initializeStaticData()
+ImageProcessor::~ImageProcessor()
 {
-    if (!s_resolutions.isEmpty()) {
-        return; // Already initialized
+    // Invalidate pending loads and let a running decode finish before the
+    // object it reports back to goes away
+    ++m_loadGeneration;
+    ++m_previewGeneration;
+    ++m_prefetchGeneration;
+    if (m_prefetchPool) {
+        m_prefetchPool->clear();
+        m_prefetchPool->waitForDone();
+    }
+    if (m_loadPool) {
+        m_loadPool->clear();
+        m_loadPool->waitForDone();
+    }
+    if (m_previewPool) {
+        m_previewPool->clear();
+        m_previewPool->waitForDone();
     }
     
-    // Initialize supported resolutions (horizontal)
-    s_resolutions = {
+    // Queued exports still write their files
+    waitForExports();
+}
+
+// The tables are function-local statics, which C++ initializes exactly once
+// even when the first calls race on different threads
+const QList<ImageProcessor::Resolution> &ImageProcessor::resolutionTable()
+{
+    static const QList<Resolution> resolutions = {
         // Standard horizontal resolutions
         {1280, 720, "HD", "1280 × 720 (HD)", false},
         {1366, 768, "WXGA", "1366 × 768 (WXGA)", false},
@@ -71,17 +138,44 @@ void ImageProcessor::initializeStaticData()
         {1920, 2880, "3:2 High-res Portrait", "1920 × 2880 (3:2 High-res Portrait)", true},
         {2000, 3000, "3:2 Ultra Portrait", "2000 × 3000 (3:2 Ultra Portrait)", true}
     };
-    
-    // Initialize output format info
-    s_outputFormats = {
-        {OutputFormat::PNG, {"png", "PNG (Portable Network Graphics)", false, true}},
-        {OutputFormat::JPEG, {"jpg", "JPEG (Joint Photographic Experts Group)", true, false}},
-        {OutputFormat::BMP, {"bmp", "BMP (Windows Bitmap)", false, false}},
-        {OutputFormat::TIFF, {"tiff", "TIFF (Tagged Image File Format)", false, true}}
+    return resolutions;
+}
+
+const QMap<ImageProcessor::OutputFormat, ImageProcessor::FormatInfo> &ImageProcessor::formatTable()
+{
+    // Speed presets, fast to smallest. Qt's PNG writer maps quality q to
+    // zlib level (100 - q) * 9 / 91, so 89, 35 and 0 give levels 1, 6 and 9.
+    // Its TIFF writer offers no compression (0) or LZW (1). JPEG adds
+    // Huffman optimization, then progressive scans.
+    static const QList<EncoderParameters> pngPresets = {
+        {89, -1, false, false},
+        {35, -1, false, false},
+        {0, -1, false, false}
+    };
+    static const QList<EncoderParameters> jpegPresets = {
+        {-1, -1, false, false},
+        {-1, -1, true, false},
+        {-1, -1, true, true}
+    };
+    static const QList<EncoderParameters> tiffPresets = {
+        {-1, 0, false, false},
+        {-1, 1, false, false},
+        {-1, 1, false, false}
     };
     
-    // Initialize default format mapping
-    s_defaultMapping = {
+    static const QMap<OutputFormat, FormatInfo> formats = {
+        {OutputFormat::PNG, {"png", "PNG (Portable Network Graphics)", false, true, pngPresets}},
+        {OutputFormat::JPEG, {"jpg", "JPEG (Joint Photographic Experts Group)", true, false, jpegPresets}},
+        {OutputFormat::BMP, {"bmp", "BMP (Windows Bitmap)", false, false, {}}},
+        {OutputFormat::TIFF, {"tiff", "TIFF (Tagged Image File Format)", false, true, tiffPresets}},
+        {OutputFormat::WEBP, {"webp", "WebP", true, true, {}}}
+    };
+    return formats;
+}
+
+const QMap<QString, ImageProcessor::OutputFormat> &ImageProcessor::defaultMappingTable()
+{
+    static const QMap<QString, OutputFormat> mapping = {
         {"jpg", OutputFormat::JPEG},
         {"jpeg", OutputFormat::JPEG},
         {"jfif", OutputFormat::JPEG},
@@ -89,38 +183,516 @@ void ImageProcessor::initializeStaticData()
         {"bmp", OutputFormat::BMP},
         {"tiff", OutputFormat::TIFF},
         {"tif", OutputFormat::TIFF},
+        {"webp", OutputFormat::WEBP},
         {"heif", OutputFormat::JPEG},  // Convert to JPEG for compatibility
         {"heic", OutputFormat::JPEG},  // Convert to JPEG for compatibility
         {"gif", OutputFormat::PNG}     // Convert to PNG to preserve quality
     };
+    return mapping;
 }
 
 bool ImageProcessor::loadImage(const QString &filePath)
 {
+    // Repeated requests, e.g. a double click, would only restart the decode
+    if (m_loading && filePath == m_loadingPath) {
+        return true;
+    }
+    
     QImageReader reader(filePath);
     if (!reader.canRead()) {
         emit errorOccurred(QString("Cannot read image file: %1").arg(filePath));
         return false;
     }
     
+    if (!m_loadPool) {
+        m_loadPool = new QThreadPool(this);
+        m_loadPool->setMaxThreadCount(2);
+    }
+    
+    // Drop loads that have not started yet; running ones become stale
+    m_loadPool->clear();
+    const quint64 generation = ++m_loadGeneration;
+    m_loading = true;
+    m_loadingPath = filePath;
+    emit loadStarted(filePath);
+    
+    // A prefetch finishing meanwhile either has its image in the cache by
+    // the time the lock is free or sees this load waiting and hands it over
+    bool adopted = false;
+    {
+        QMutexLocker locker(&m_prefetchMutex);
+        
+        // Queued prefetches are the old image's neighbours; this image's are
+        // queued once it has loaded, and any not started would only compete
+        ++m_prefetchGeneration;
+        if (m_prefetchPool) {
+            m_prefetchPool->clear();
+        }
+        
+        // Still delivered asynchronously, like a decode, so callers see the
+        // same signal order either way
+        DecodedImageCache::Entry cached;
+        if (m_decodeCache.lookup(filePath, &cached)) {
+            QMetaObject::invokeMethod(this, [this, generation, filePath, cached]() {
+                finishLoad(generation, filePath, cached.image, cached.preview, cached.sourceSize, 0, QString());
+            }, Qt::QueuedConnection);
+            return true;
+        }
+        
+        if (m_prefetchingPath == filePath) {
+            m_prefetchAdopter = generation;
+            adopted = true;
+        }
+    }
+    
+    // Read on the second load thread, alongside the decode
+    if (m_proxyCache.budget() > 0) {
+        m_loadPool->start([this, filePath, generation]() {
+            TRACE_SCOPE("ImageProcessor::loadImage (proxy)");
+            QSize sourceSize;
+            const QImage proxy = m_proxyCache.lookup(filePath, &sourceSize);
+            if (proxy.isNull() || generation != m_loadGeneration) {
+                return;
+            }
+            QMetaObject::invokeMethod(this, [this, generation, filePath, proxy, sourceSize]() {
+                finishProxy(generation, filePath, proxy, sourceSize);
+            }, Qt::QueuedConnection);
+        });
+    }
+    
+    if (adopted) {
+        return true;
+    }
+    
+    const qint64 budget = m_memoryBudget;
+    m_loadPool->start([this, filePath, generation, budget]() {
+        TRACE_SCOPE("ImageProcessor::loadImage (worker)");
+        QElapsedTimer timer;
+        timer.start();
+        QString error;
+        const DecodedImageCache::Entry entry = decodeForDisplay(filePath, budget, &error);
+        const qint64 decodeMs = timer.elapsed();
+        
+        // Cached even when superseded, in case the user flips back to it
+        if (!entry.image.isNull()) {
+            m_decodeCache.insert(filePath, entry);
+        }
+        if (generation == m_loadGeneration) {
+            QMetaObject::invokeMethod(this, [this, generation, filePath, entry, decodeMs, error]() {
+                finishLoad(generation, filePath, entry.image, entry.preview, entry.sourceSize, decodeMs, error);
+            }, Qt::QueuedConnection);
+        }
+        
+        // After delivering the image, so writing never delays it
+        storeProxy(filePath, entry);
+    });
+    
+    return true;
+}
+
+DecodedImageCache::Entry ImageProcessor::decodeForDisplay(const QString &filePath, qint64 memoryBudget,
+                                                          QString *errorString)
+{
+    DecodedImageCache::Entry entry;
+    const QImageReader reader(filePath);
+    entry.sourceSize = reader.size();
+    if (entry.sourceSize.isValid() && (imageBytes(entry.sourceSize) > memoryBudget
+                                       || exceedsReaderAllocationLimit(entry.sourceSize, reader.imageFormat()))) {
+        entry.image = decodeProxy(filePath, entry.sourceSize, memoryBudget, errorString);
+    } else {
+        entry.image = decodeImage(filePath, errorString);
+        entry.sourceSize = entry.image.size();
+    }
+    
+    // Downscale once here so slider previews never touch the full image
+    entry.preview = entry.image;
+    if (entry.image.width() > kPreviewMaxDimension || entry.image.height() > kPreviewMaxDimension) {
+        QSize previewSize = entry.image.size().scaled(kPreviewMaxDimension, kPreviewMaxDimension,
+                                                      Qt::KeepAspectRatio);
+        entry.preview = Resampler::resample(entry.image, QRectF(entry.image.rect()), previewSize,
+                                            Resampler::Filter::Mitchell);
+    }
+    return entry;
+}
+
+void ImageProcessor::prefetch(const QStringList &filePaths)
+{
+    if (!m_prefetchPool) {
+        // One low-priority thread, so prefetching only uses otherwise idle cores
+        m_prefetchPool = new QThreadPool(this);
+        m_prefetchPool->setMaxThreadCount(1);
+        m_prefetchPool->setThreadPriority(QThread::LowestPriority);
+    }
+    
+    // Neighbours of an earlier image are no longer worth decoding
+    m_prefetchPool->clear();
+    const quint64 generation = ++m_prefetchGeneration;
+    const qint64 budget = m_memoryBudget;
+    if (m_decodeCache.budget() == 0) {
+        return; // Nowhere to keep the results
+    }
+    
+    qint64 remaining = m_prefetchMemory;
+    for (const QString &filePath : filePaths) {
+        if (m_decodeCache.contains(filePath)) {
+            continue;
+        }
+        
+        // Estimated from the header: the full image, or a proxy of at most
+        // a quarter of the memory budget. The small preview is not counted.
+        const QSize size = QImageReader(filePath).size();
+        if (!size.isValid()) {
+            continue;
+        }
+        const qint64 bytes = qMin(imageBytes(size), budget / 4 + 1);
+        if (bytes > remaining) {
+            break;
+        }
+        remaining -= bytes;
+        
+        m_prefetchPool->start([this, filePath, generation, budget]() {
+            {
+                QMutexLocker locker(&m_prefetchMutex);
+                if (generation != m_prefetchGeneration) {
+                    return;
+                }
+                m_prefetchingPath = filePath;
+            }
+            TRACE_SCOPE("ImageProcessor::prefetch");
+            QElapsedTimer timer;
+            timer.start();
+            QString error;
+            const DecodedImageCache::Entry entry = decodeForDisplay(filePath, budget, &error);
+            const qint64 decodeMs = timer.elapsed();
+            
+            quint64 adopter = 0;
+            {
+                QMutexLocker locker(&m_prefetchMutex);
+                if (!entry.image.isNull()) {
+                    m_decodeCache.insert(filePath, entry);
+                }
+                m_prefetchingPath.clear();
+                adopter = m_prefetchAdopter;
+                m_prefetchAdopter = 0;
+            }
+            
+            // A load of this file started while it decoded and is waiting
+            // for it, so the result, or the error, is its own
+            if (adopter != 0 && adopter == m_loadGeneration) {
+                QMetaObject::invokeMethod(this, [this, adopter, filePath, entry, decodeMs, error]() {
+                    finishLoad(adopter, filePath, entry.image, entry.preview, entry.sourceSize, decodeMs, error);
+                }, Qt::QueuedConnection);
+            }
+            storeProxy(filePath, entry);
+        });
+    }
+}
+
+void ImageProcessor::setPrefetchMemoryMB(int megabytes)
+{
+    m_prefetchMemory = static_cast<qint64>(qMax(0, megabytes)) * 1024 * 1024;
+}
+
+void ImageProcessor::storeProxy(const QString &filePath, const DecodedImageCache::Entry &entry)
+{
+    // Images that fit the preview decode about as fast as a proxy would
+    if (entry.preview.cacheKey() != entry.image.cacheKey()) {
+        m_proxyCache.store(filePath, entry.preview, entry.sourceSize);
+    }
+}
+
+void ImageProcessor::setProxyCacheMB(int megabytes)
+{
+    m_proxyCache.setBudget(static_cast<qint64>(qMax(0, megabytes)) * 1024 * 1024);
+}
+
+QImage ImageProcessor::decodeImage(const QString &filePath, QString *errorString)
+{
+    TRACE_SCOPE("ImageProcessor::decodeImage");
+    QImageReader reader(filePath);
+    QImage image = reader.read();
+    if (image.isNull() && errorString) {
+        *errorString = reader.errorString();
+    }
+    return image;
+}
+
+QImage ImageProcessor::decodeRegion(const QString &filePath, const QRect &clipRect, const QSize &minimumSize,
+                                   QRect *decodedRect, QString *errorString)
+{
+    TRACE_SCOPE("ImageProcessor::decodeRegion");
+    QImageReader reader(filePath);
+    const QSize fullSize = reader.size();
+    
+    // Without a size from the header there is nothing to clip against
+    if (!fullSize.isValid()) {
+        QImage image = reader.read();
+        if (image.isNull() && errorString) {
+            *errorString = reader.errorString();
+        }
+        if (decodedRect) {
+            *decodedRect = image.rect();
+        }
+        return image;
+    }
+    
+    QRect area = clipRect.intersected(QRect(QPoint(0, 0), fullSize));
+    if (area.isEmpty()) {
+        if (errorString) {
+            *errorString = "Crop area lies outside the image";
+        }
+        return QImage();
+    }
+    
+    // Power-of-two reductions map directly onto JPEG's DCT scaling; other
+    // handlers would decode in full and rescale, so leave their size alone
+    int denominator = 1;
+    if (reader.supportsOption(QImageIOHandler::ScaledSize)) {
+        while (denominator < 8
+               && area.width() / (denominator * 2) >= minimumSize.width()
+               && area.height() / (denominator * 2) >= minimumSize.height()) {
+            denominator *= 2;
+        }
+    }
+    
+    if (area.size() != fullSize) {
+        reader.setClipRect(area);
+    }
+    if (denominator > 1) {
+        reader.setScaledSize(QSize((area.width() + denominator - 1) / denominator,
+                                   (area.height() + denominator - 1) / denominator));
+    }
+    
     QImage image = reader.read();
+    if (image.isNull() && errorString) {
+        *errorString = reader.errorString();
+    }
+    if (decodedRect) {
+        *decodedRect = area;
+    }
+    return image;
+}
+
+QImage ImageProcessor::decodeProxy(const QString &filePath, const QSize &sourceSize, qint64 memoryBudget,
+                                   QString *errorString)
+{
+    TRACE_SCOPE("ImageProcessor::decodeProxy");
+    // Keep the proxy to a quarter of the budget
+    QSize proxySize = sourceSize.scaled(kProxyMaxDimension, kProxyMaxDimension, Qt::KeepAspectRatio);
+    while (imageBytes(proxySize) > memoryBudget / 4 && proxySize.width() > 1 && proxySize.height() > 1) {
+        proxySize = QSize(qMax(1, proxySize.width() / 2), qMax(1, proxySize.height() / 2));
+    }
+    
+    // Handlers that scale while decoding (JPEG) never hold the full image.
+    // Those that decode in full first may be refused by the allocation
+    // limit, and such files are streamed instead.
+    QImageReader reader(filePath);
+    if (reader.supportsOption(QImageIOHandler::ScaledSize)) {
+        reader.setScaledSize(proxySize);
+        QImage image = reader.read();
+        if (!image.isNull()) {
+            return image;
+        }
+    }
+    
+    return streamResample(filePath, QRectF(QPointF(0, 0), QSizeF(sourceSize)), proxySize,
+                          Resampler::Filter::Mitchell, memoryBudget, errorString);
+}
+
+QImage ImageProcessor::streamResample(const QString &filePath, const QRectF &sourceRect, const QSize &targetSize,
+                                      Resampler::Filter filter, qint64 memoryBudget, QString *errorString)
+{
+    TRACE_SCOPE("ImageProcessor::streamResample");
+    const Resampler resampler(sourceRect, targetSize, filter);
+    if (!resampler.isValid()) {
+        if (errorString) {
+            *errorString = "Empty crop area or output size";
+        }
+        return QImage();
+    }
+    
+    // Without dimensions from the header there is nothing to plan strips by
+    if (!QImageReader(filePath).size().isValid()) {
+        QImage image = decodeImage(filePath, errorString);
+        return image.isNull() ? QImage() : resampler.resample(image);
+    }
+    
+    ScanlineReader reader(filePath);
+    if (!reader.isValid()) {
+        if (errorString) {
+            *errorString = QString("%1. The image is larger than the memory budget; raise it in "
+                                   "Settings to decode it whole.").arg(reader.errorString());
+        }
+        return QImage();
+    }
+    const QSize sourceSize = reader.size();
+    
+    // Full-width strips cost their source rows, held twice while the rows
+    // shared with the previous strip are copied, plus the intermediate rows
+    // the horizontal pass makes from them; the output is held whole
+    const qint64 rowBytes = 4LL * (2 * sourceSize.width() + targetSize.width());
+    const qint64 available = memoryBudget - imageBytes(targetSize);
+    const int maxRows = static_cast<int>(qBound<qint64>(1, available / rowBytes, sourceSize.height()));
+    
+    QImage result;
+    QList<QPair<int, int>> pending; // Bands entirely outside the image
+    
+    int begin = 0;
+    while (begin < targetSize.height()) {
+        // Grow the band while its source rows fit, but always take one row
+        int first = 0;
+        int last = 0;
+        int end = begin + 1;
+        while (end < targetSize.height()) {
+            resampler.sourceRows(begin, end + 1, &first, &last);
+            if (last - first > maxRows) {
+                break;
+            }
+            ++end;
+        }
+        resampler.sourceRows(begin, end, &first, &last);
+        first = qMax(first, 0);
+        last = qMin(last, sourceSize.height());
+        
+        // Bands move down the image, so the reader never goes back
+        QImage strip;
+        if (first < last) {
+            strip = reader.read(first, last);
+            if (strip.isNull()) {
+                if (errorString) {
+                    *errorString = reader.errorString();
+                }
+                return QImage();
+            }
+        }
+        
+        // The output format follows the decoded pixels, so wait for a strip
+        if (result.isNull()) {
+            if (strip.isNull()) {
+                pending.append(qMakePair(begin, end));
+                begin = end;
+                continue;
+            }
+            result = resampler.createTarget(strip);
+            if (result.isNull()) {
+                if (errorString) {
+                    *errorString = "Not enough memory for the output image";
+                }
+                return QImage();
+            }
+            for (const auto &band : pending) {
+                resampler.resampleRows(QImage(), 0, &result, band.first, band.second);
+            }
+        }
+        
+        resampler.resampleRows(strip, first, &result, begin, end);
+        begin = end;
+    }
+    
+    if (result.isNull() && errorString) {
+        *errorString = "Crop area lies outside the image";
+    }
+    return result;
+}
+
+void ImageProcessor::setMemoryBudgetMB(int megabytes)
+{
+    m_memoryBudget = static_cast<qint64>(qMax(1, megabytes)) * 1024 * 1024;
+}
+
+void ImageProcessor::setReaderAllocationLimit(int megabytes)
+{
+    QImageReader::setAllocationLimit(qMax(1, megabytes));
+}
+
+bool ImageProcessor::exceedsReaderAllocationLimit(const QSize &size, QImage::Format format)
+{
+    // Qt counts at least 4 bytes per pixel, more for deeper formats; 0 means no limit
+    const qint64 limit = static_cast<qint64>(QImageReader::allocationLimit()) * 1024 * 1024;
+    const int bytesPerPixel = qMax(4, QImage::toPixelFormat(format).bitsPerPixel() / 8);
+    return limit > 0 && static_cast<qint64>(bytesPerPixel) * size.width() * size.height() > limit;
+}
+
+void ImageProcessor::setDecodeCacheMB(int megabytes)
+{
+    m_decodeCache.setBudget(static_cast<qint64>(qMax(0, megabytes)) * 1024 * 1024);
+}
+
+QList<ImageProcessor::BufferUsage> ImageProcessor::memoryUsage() const
+{
+    QList<BufferUsage> usage;
+    QList<qint64> seen;
+    auto add = [&usage, &seen](const QString &name, const QImage &image) {
+        if (image.isNull()) {
+            return;
+        }
+        // Implicitly shared copies have the same cache key
+        const bool shared = seen.contains(image.cacheKey());
+        seen.append(image.cacheKey());
+        usage.append({name, image.size(), shared ? 0 : image.sizeInBytes(), shared});
+    };
+    
+    add(m_streaming ? "Source proxy" : "Source image", m_sourceImage);
+    add("Preview base", m_previewBase);
+    add("Adjusted preview", m_adjustedPreview);
+    
+    // Other recently opened images; entries sharing the buffers above are free
+    const qint64 cacheBytes = m_decodeCache.bytesExcluding(seen);
+    if (cacheBytes > 0) {
+        usage.append({"Decoded image cache", QSize(), cacheBytes, false});
+    }
+    return usage;
+}
+
+void ImageProcessor::finishLoad(quint64 generation, const QString &filePath, const QImage &image,
+                                const QImage &preview, const QSize &sourceSize, qint64 decodeMs,
+                                const QString &error)
+{
+    TRACE_SCOPE("ImageProcessor::finishLoad");
+    if (generation != m_loadGeneration) {
+        return; // Superseded by a newer load
+    }
+    
+    m_loading = false;
+    m_loadingPath.clear();
+    
     if (image.isNull()) {
-        emit errorOccurred(QString("Failed to load image: %1").arg(reader.errorString()));
-        return false;
+        emit loadFailed(filePath, QString("Failed to load image: %1").arg(error));
+        return;
     }
     
-    m_originalImage = image;
-    m_currentImage = image;
+    m_performance.decodeMs = decodeMs;
+    m_sourceImage = image;
+    m_previewBase = preview;
+    m_adjustedPreview = QImage();
     m_currentFilePath = filePath;
+    m_sourceSize = sourceSize;
+    m_streaming = (image.size() != sourceSize);
+    ++m_previewGeneration;
     
     // Set default output format based on input format
     QString extension = QFileInfo(filePath).suffix().toLower();
-    if (s_defaultMapping.contains(extension)) {
-        m_outputFormat = s_defaultMapping[extension];
+    const QMap<QString, OutputFormat> &mapping = defaultMappingTable();
+    if (mapping.contains(extension)) {
+        m_outputFormat = mapping.value(extension);
     }
     
     emit imageLoaded(filePath);
-    return true;
+    
+    // Adjustments carried over from the previous image
+    if (m_brightness != 0 || m_contrast != 0 || m_saturation != 0) {
+        schedulePreview();
+    }
+}
+
+void ImageProcessor::finishProxy(quint64 generation, const QString &filePath, const QImage &proxy,
+                                 const QSize &sourceSize)
+{
+    // Only of use while the decode is still running
+    if (generation != m_loadGeneration || !m_loading) {
+        return;
+    }
+    emit proxyLoaded(filePath, proxy, sourceSize);
 }
 
 QString ImageProcessor::detectInputFormat(const QString &filePath)
@@ -131,146 +703,921 @@ QString ImageProcessor::detectInputFormat(const QString &filePath)
 void ImageProcessor::setBrightness(int brightness)
 {
     m_brightness = qBound(-100, brightness, 100);
-    m_currentImage = applyAdjustments(m_originalImage);
-    emit imageProcessed();
+    schedulePreview();
 }
 
 void ImageProcessor::setContrast(int contrast)
 {
     m_contrast = qBound(-100, contrast, 100);
-    m_currentImage = applyAdjustments(m_originalImage);
-    emit imageProcessed();
+    schedulePreview();
 }
 
 void ImageProcessor::setSaturation(int saturation)
 {
     m_saturation = qBound(-100, saturation, 100);
-    m_currentImage = applyAdjustments(m_originalImage);
-    emit imageProcessed();
+    schedulePreview();
 }
 
-QImage ImageProcessor::applyAdjustments(const QImage &image) const
+void ImageProcessor::schedulePreview()
 {
-    QImage result = image;
+    if (m_sourceImage.isNull()) {
+        return;
+    }
     
-    if (m_brightness != 0) {
-        result = adjustBrightness(result, m_brightness);
+    // Any preview still rendering is now stale
+    ++m_previewGeneration;
+    
+    if (!m_previewTimer) {
+        m_previewTimer = new QTimer(this);
+        m_previewTimer->setSingleShot(true);
+        m_previewTimer->setInterval(kPreviewIntervalMs);
+        connect(m_previewTimer, &QTimer::timeout, this, &ImageProcessor::renderPreview);
     }
     
-    if (m_contrast != 0) {
-        result = adjustContrast(result, m_contrast);
+    // Not restarted while pending, so a dragged slider still previews at a
+    // steady rate instead of waiting for the drag to stop
+    if (!m_previewTimer->isActive()) {
+        m_previewTimer->start();
     }
+}
+
+void ImageProcessor::renderPreview()
+{
+    const quint64 generation = ++m_previewGeneration;
     
-    if (m_saturation != 0) {
-        result = adjustSaturation(result, m_saturation);
+    if (m_brightness == 0 && m_contrast == 0 && m_saturation == 0) {
+        m_adjustedPreview = QImage();
+        emit imageProcessed();
+        return;
     }
     
-    return result;
+    if (!m_previewPool) {
+        m_previewPool = new QThreadPool(this);
+        m_previewPool->setMaxThreadCount(1);
+    }
+    m_previewPool->clear();
+    
+    const QImage source = m_previewBase;
+    const int brightness = m_brightness;
+    const int contrast = m_contrast;
+    const int saturation = m_saturation;
+    
+    m_previewPool->start([this, generation, source, brightness, contrast, saturation]() {
+        auto isStale = [this, generation]() { return generation != m_previewGeneration; };
+        QElapsedTimer timer;
+        timer.start();
+        QImage preview = adjustPixels(source, brightness, contrast, saturation, isStale);
+        if (preview.isNull() || isStale()) {
+            return;
+        }
+        const qint64 adjustMs = timer.elapsed();
+        QMetaObject::invokeMethod(this, [this, generation, preview, adjustMs]() {
+            finishPreview(generation, preview, adjustMs);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ImageProcessor::finishPreview(quint64 generation, const QImage &preview, qint64 adjustMs)
+{
+    if (generation != m_previewGeneration) {
+        return; // Newer slider input arrived
+    }
+    
+    m_performance.adjustMs = adjustMs;
+    m_adjustedPreview = preview;
+    emit imageProcessed();
+}
+
+QImage ImageProcessor::applyAdjustments(const QImage &image) const
+{
+    if (m_brightness == 0 && m_contrast == 0 && m_saturation == 0) {
+        return image;
+    }
+    
+    return adjustPixels(image, m_brightness, m_contrast, m_saturation);
 }
 
 QImage ImageProcessor::adjustBrightness(const QImage &image, int brightness) const
 {
-    QImage result = image.convertToFormat(QImage::Format_ARGB32);
-    int adjustment = brightness * 255 / 100;
+    return adjustPixels(image, brightness, 0, 0);
+}
+
+QImage ImageProcessor::adjustContrast(const QImage &image, int contrast) const
+{
+    return adjustPixels(image, 0, contrast, 0);
+}
+
+QImage ImageProcessor::adjustSaturation(const QImage &image, int saturation) const
+{
+    return adjustPixels(image, 0, 0, saturation);
+}
+
+QImage ImageProcessor::adjustPixels(const QImage &image, int brightness, int contrast, int saturation,
+                                    const std::function<bool()> &isCancelled)
+{
+    TRACE_SCOPE("ImageProcessor::adjustPixels");
+    // Formats we can read directly are written into a fresh buffer; anything
+    // else is converted once and then adjusted in place.
+    QImage source;
+    QImage result;
+    if (image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_RGB32) {
+        source = image;
+        result = QImage(image.size(), QImage::Format_ARGB32);
+        result.setDotsPerMeterX(image.dotsPerMeterX());
+        result.setDotsPerMeterY(image.dotsPerMeterY());
+        result.setColorSpace(image.colorSpace());
+    } else {
+        result = image.convertToFormat(QImage::Format_ARGB32);
+    }
+    const QImage &input = source.isNull() ? result : source;
+    
+    const PixelKernels::Params params = PixelKernels::makeParams(brightness, contrast, saturation);
+    
+    // Resolve the buffers up front; scanLine() may detach and is not safe to
+    // call from several threads at once.
+    uchar *outBits = result.bits();
+    const uchar *inBits = input.constBits();
+    const qsizetype outStride = result.bytesPerLine();
+    const qsizetype inStride = input.bytesPerLine();
+    const int width = result.width();
     
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
-            int r = qBound(0, qRed(pixel) + adjustment, 255);
-            int g = qBound(0, qGreen(pixel) + adjustment, 255);
-            int b = qBound(0, qBlue(pixel) + adjustment, 255);
-            line[x] = qRgba(r, g, b, qAlpha(pixel));
+    ParallelFor::run(result.height(), [&](int begin, int end) {
+        if (isCancelled && isCancelled()) {
+            return;
         }
+        for (int y = begin; y < end; ++y) {
+            const QRgb *in = reinterpret_cast<const QRgb*>(inBits + y * inStride);
+            QRgb *out = reinterpret_cast<QRgb*>(outBits + y * outStride);
+            PixelKernels::adjustRow(in, out, width, params);
+        }
+    });
+    
+    if (isCancelled && isCancelled()) {
+        return QImage();
     }
     
     return result;
 }
 
-QImage ImageProcessor::adjustContrast(const QImage &image, int contrast) const
+void ImageProcessor::setOutputFormat(OutputFormat format)
+{
+    m_outputFormat = format;
+}
+
+void ImageProcessor::setJpegQuality(int quality)
+{
+    m_jpegQuality = qBound(1, quality, 100);
+}
+
+void ImageProcessor::setAdditionalFormats(const QList<OutputFormat> &formats)
+{
+    m_additionalFormats = formats;
+}
+
+void ImageProcessor::setMaxFileSizeKB(int kilobytes)
+{
+    m_maxFileSizeKB = qMax(0, kilobytes);
+}
+
+void ImageProcessor::setEncoderSpeed(OutputFormat format, EncoderSpeed speed)
+{
+    m_encoderSpeeds[format] = speed;
+}
+
+ImageProcessor::EncoderSpeed ImageProcessor::getEncoderSpeed(OutputFormat format) const
+{
+    return m_encoderSpeeds.value(format, EncoderSpeed::Balanced);
+}
+
+ImageProcessor::EncodeOptions ImageProcessor::encodeOptions() const
+{
+    EncodeOptions options;
+    options.quality = m_jpegQuality;
+    options.maxFileBytes = static_cast<qint64>(m_maxFileSizeKB) * 1024;
+    options.speeds = m_encoderSpeeds;
+    return options;
+}
+
+void ImageProcessor::configureWriter(QImageWriter *writer, OutputFormat format, const EncodeOptions &options,
+                                     int quality)
+{
+    const FormatInfo info = formatTable().value(format);
+    if (info.supportsQuality) {
+        writer->setQuality(quality);
+    }
+    
+    const int speed = static_cast<int>(options.speeds.value(format, EncoderSpeed::Balanced));
+    if (speed >= info.speedPresets.size()) {
+        return;
+    }
+    const EncoderParameters &parameters = info.speedPresets[speed];
+    if (parameters.quality >= 0) {
+        writer->setQuality(parameters.quality);
+    }
+    if (parameters.compression >= 0) {
+        writer->setCompression(parameters.compression);
+    }
+    writer->setOptimizedWrite(parameters.optimizedWrite);
+    writer->setProgressiveScanWrite(parameters.progressiveScanWrite);
+}
+
+QList<ImageProcessor::OutputFormat> ImageProcessor::outputFormats() const
+{
+    QList<OutputFormat> formats{m_outputFormat};
+    for (OutputFormat format : m_additionalFormats) {
+        if (!formats.contains(format)) {
+            formats << format;
+        }
+    }
+    return formats;
+}
+
+QImage ImageProcessor::cropAndScale(const QImage &image, const QSize &targetSize, const QRect &cropRect,
+                                   Resampler::Filter filter)
+{
+    TRACE_SCOPE("ImageProcessor::cropAndScale");
+    // The resampler reads the crop straight out of the image
+    return Resampler::resample(image, QRectF(cropRect), targetSize, filter);
+}
+
+QRect ImageProcessor::centerCropRect(const QSize &imageSize, const QSize &targetSize)
+{
+    // Largest rect with the target aspect ratio, centered in the image
+    QSize cropSize = targetSize.scaled(imageSize, Qt::KeepAspectRatio);
+    QPoint topLeft((imageSize.width() - cropSize.width()) / 2,
+                   (imageSize.height() - cropSize.height()) / 2);
+    return QRect(topLeft, cropSize);
+}
+
+QImage ImageProcessor::renderWallpaper(const QSize &targetSize, const QRect &cropRect)
+{
+    QString error;
+    QImage image = renderSnapshot(renderSource(), targetSize, cropRect, &error);
+    if (image.isNull()) {
+        emit errorOccurred(QString("Failed to render wallpaper: %1").arg(error));
+    }
+    return image;
+}
+
+ImageProcessor::RenderSource ImageProcessor::renderSource() const
 {
-    QImage result = image.convertToFormat(QImage::Format_ARGB32);
-    double factor = (259.0 * (contrast + 255.0)) / (255.0 * (259.0 - contrast));
+    RenderSource source;
+    source.image = m_streaming ? QImage() : m_sourceImage;
+    source.filePath = m_currentFilePath;
+    source.memoryBudget = m_memoryBudget;
+    source.brightness = m_brightness;
+    source.contrast = m_contrast;
+    source.saturation = m_saturation;
+    return source;
+}
+
+QImage ImageProcessor::renderSnapshot(const RenderSource &source, const QSize &targetSize, const QRect &cropRect,
+                                      QString *errorString)
+{
+    TRACE_SCOPE("ImageProcessor::renderSnapshot");
+    if (!source.image.isNull()) {
+        QImage image = renderWallpaper(source.image, targetSize, cropRect,
+                                       source.brightness, source.contrast, source.saturation);
+        if (image.isNull() && errorString) {
+            *errorString = "Not enough memory for the output image";
+        }
+        return image;
+    }
+    
+    // Same filter as cropAndScale, so the pixels match the in-memory path
+    QImage scaled = streamResample(source.filePath, QRectF(cropRect), targetSize,
+                                   Resampler::Filter::Lanczos3, source.memoryBudget, errorString);
+    if (scaled.isNull() || (source.brightness == 0 && source.contrast == 0 && source.saturation == 0)) {
+        return scaled;
+    }
+    return adjustPixels(scaled, source.brightness, source.contrast, source.saturation);
+}
+
+QImage ImageProcessor::renderWallpaper(const QImage &source, const QSize &targetSize, const QRect &cropRect,
+                                       int brightness, int contrast, int saturation)
+{
+    // Adjusting after the resample keeps the per-pixel cost proportional to
+    // the output size, and starting from the original avoids adjusting twice.
+    QImage scaled = cropAndScale(source, targetSize, cropRect);
+    if (brightness == 0 && contrast == 0 && saturation == 0) {
+        return scaled;
+    }
+    return adjustPixels(scaled, brightness, contrast, saturation);
+}
+
+QList<ImageProcessor::ExportResult> ImageProcessor::renderWallpapers(const QList<QSize> &targetSizes,
+                                                                    const QRect &cropRect, bool verify)
+{
+    QStringList errors;
+    QList<ExportResult> results = renderSnapshots(renderSource(), targetSizes, cropRect, verify, &errors);
+    for (const QString &error : errors) {
+        emit errorOccurred(error);
+    }
+    return results;
+}
+
+QList<ImageProcessor::ExportResult> ImageProcessor::renderSnapshots(const RenderSource &source,
+                                                                   const QList<QSize> &targetSizes,
+                                                                   const QRect &cropRect, bool verify,
+                                                                   QStringList *errors)
+{
+    QList<ExportResult> results;
+    if (!source.image.isNull()) {
+        results = renderCascade(source.image, targetSizes, cropRect, verify);
+    } else {
+        // No resident crop to cascade from, so each output streams from the file
+        for (const QSize &target : targetSizes) {
+            QRect region = centerCropRect(cropRect.size(), target).translated(cropRect.topLeft());
+            QString error;
+            ExportResult result;
+            result.size = target;
+            result.image = streamResample(source.filePath, QRectF(region), target,
+                                          Resampler::Filter::Lanczos3, source.memoryBudget, &error);
+            result.resampledFrom = region.size();
+            result.cascaded = false;
+            result.verified = false;
+            result.psnr = std::numeric_limits<double>::infinity();
+            if (result.image.isNull() && errors) {
+                *errors << QString("Failed to render %1x%2: %3")
+                           .arg(target.width()).arg(target.height()).arg(error);
+            }
+            results.append(result);
+        }
+    }
     
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
-            int r = qBound(0, static_cast<int>(factor * (qRed(pixel) - 128) + 128), 255);
-            int g = qBound(0, static_cast<int>(factor * (qGreen(pixel) - 128) + 128), 255);
-            int b = qBound(0, static_cast<int>(factor * (qBlue(pixel) - 128) + 128), 255);
-            line[x] = qRgba(r, g, b, qAlpha(pixel));
+    // Adjust at output size, as in the single-resolution path
+    if (source.brightness != 0 || source.contrast != 0 || source.saturation != 0) {
+        for (ExportResult &result : results) {
+            if (!result.image.isNull()) {
+                result.image = adjustPixels(result.image, source.brightness, source.contrast, source.saturation);
+            }
         }
     }
     
-    return result;
+    return results;
 }
 
-QImage ImageProcessor::adjustSaturation(const QImage &image, int saturation) const
+QList<ImageProcessor::ExportResult> ImageProcessor::renderCascade(const QImage &original,
+                                                                 const QList<QSize> &targetSizes,
+                                                                 const QRect &cropRect, bool verify)
 {
-    QImage result = image.convertToFormat(QImage::Format_ARGB32);
-    double factor = (saturation + 100.0) / 100.0;
+    TRACE_SCOPE("ImageProcessor::renderCascade");
+    // Every output is a centered sub-rect of the crop, read in place from
+    // the source rather than copied out of it
+    const QPoint origin = cropRect.topLeft();
     
-    for (int y = 0; y < result.height(); ++y) {
-        QRgb *line = reinterpret_cast<QRgb*>(result.scanLine(y));
-        for (int x = 0; x < result.width(); ++x) {
-            QRgb pixel = line[x];
-            int r = qRed(pixel);
-            int g = qGreen(pixel);
-            int b = qBlue(pixel);
-            
-            // Convert to grayscale
-            int gray = static_cast<int>(0.299 * r + 0.587 * g + 0.114 * b);
-            
-            // Apply saturation
-            r = qBound(0, static_cast<int>(gray + factor * (r - gray)), 255);
-            g = qBound(0, static_cast<int>(gray + factor * (g - gray)), 255);
-            b = qBound(0, static_cast<int>(gray + factor * (b - gray)), 255);
+    // Largest outputs first so the smaller ones can be resampled from them
+    QList<int> order(targetSizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&targetSizes](int a, int b) {
+        return static_cast<qint64>(targetSizes[a].width()) * targetSizes[a].height()
+             > static_cast<qint64>(targetSizes[b].width()) * targetSizes[b].height();
+    });
+    
+    struct Intermediate {
+        QImage image;
+        QRect region; // In crop coordinates
+    };
+    QList<Intermediate> cascade;
+    QList<QRect> regions(targetSizes.size());
+    QList<ExportResult> results(targetSizes.size());
+    
+    for (int index : order) {
+        const QSize target = targetSizes[index];
+        const QRect region = centerCropRect(cropRect.size(), target);
+        
+        // Smallest earlier output that covers the region at no less than the target size
+        int from = -1;
+        for (int i = 0; i < cascade.size(); ++i) {
+            const QImage &candidate = cascade[i].image;
+            if (!cascade[i].region.contains(region)
+                || candidate.width() < target.width() || candidate.height() < target.height()) {
+                continue;
+            }
+            if (from < 0 || static_cast<qint64>(candidate.width()) * candidate.height()
+                          < static_cast<qint64>(cascade[from].image.width()) * cascade[from].image.height()) {
+                from = i;
+            }
+        }
+        
+        ExportResult &result = results[index];
+        result.size = target;
+        result.cascaded = (from >= 0);
+        result.verified = false;
+        result.psnr = std::numeric_limits<double>::infinity();
+        
+        if (result.cascaded) {
+            const Intermediate &source = cascade[from];
+            double sx = static_cast<double>(source.image.width()) / source.region.width();
+            double sy = static_cast<double>(source.image.height()) / source.region.height();
+            QRectF mapped((region.x() - source.region.x()) * sx, (region.y() - source.region.y()) * sy,
+                          region.width() * sx, region.height() * sy);
+            result.image = Resampler::resample(source.image, mapped, target);
+            result.resampledFrom = source.image.size();
+        } else {
+            result.image = cropAndScale(original, target, region.translated(origin));
+            result.resampledFrom = region.size();
+        }
+        
+        regions[index] = region;
+        cascade.append({result.image, region});
+    }
+    
+    if (verify) {
+        // Direct resamples are independent of each other, so check them in parallel
+        QThreadPool pool;
+        for (int i = 0; i < results.size(); ++i) {
+            if (!results[i].cascaded) {
+                continue;
+            }
+            ExportResult *result = &results[i];
+            const QRect region = regions[i];
+            pool.start([&original, origin, result, region]() {
+                QImage direct = cropAndScale(original, result->size, region.translated(origin));
+                result->psnr = computePsnr(direct, result->image);
+                result->verified = true;
+                if (result->psnr < CascadeMinPsnr) {
+                    result->image = direct;
+                    result->resampledFrom = region.size();
+                    result->cascaded = false;
+                }
+            });
+        }
+        pool.waitForDone();
+    }
+    
+    return results;
+}
+
+double ImageProcessor::computePsnr(const QImage &a, const QImage &b)
+{
+    if (a.size() != b.size() || a.isNull()) {
+        return 0.0;
+    }
+    
+    const QImage first = a.convertToFormat(QImage::Format_RGB32);
+    const QImage second = b.convertToFormat(QImage::Format_RGB32);
+    const int width = first.width();
+    
+    // Per-row sums keep the total independent of how rows are split
+    std::vector<quint64> rowErrors(first.height(), 0);
+    ParallelFor::run(first.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const QRgb *p = reinterpret_cast<const QRgb*>(first.constScanLine(y));
+            const QRgb *q = reinterpret_cast<const QRgb*>(second.constScanLine(y));
+            quint64 sum = 0;
+            for (int x = 0; x < width; ++x) {
+                int dr = qRed(p[x]) - qRed(q[x]);
+                int dg = qGreen(p[x]) - qGreen(q[x]);
+                int db = qBlue(p[x]) - qBlue(q[x]);
+                sum += dr * dr + dg * dg + db * db;
+            }
+            rowErrors[y] = sum;
+        }
+    });
+    
+    quint64 total = std::accumulate(rowErrors.begin(), rowErrors.end(), quint64(0));
+    if (total == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    
+    double mse = static_cast<double>(total) / (3.0 * width * first.height());
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+bool ImageProcessor::saveImage(const QString &basePath, const QString &suffix, const QImage &image)
+{
+    QList<EncodeResult> results = saveImage(basePath, suffix, image, outputFormats());
+    return std::all_of(results.begin(), results.end(), [](const EncodeResult &result) {
+        return result.error.isEmpty();
+    });
+}
+
+QList<ImageProcessor::EncodeResult> ImageProcessor::saveImage(const QString &basePath, const QString &suffix,
+                                                              const QImage &image,
+                                                              const QList<OutputFormat> &formats)
+{
+    // One rendered image, encoded to every format at once
+    QList<EncodeTask> tasks;
+    for (OutputFormat format : formats) {
+        tasks.append({image, outputFilePath(basePath, suffix, format), format});
+    }
+    
+    QList<EncodeResult> results = encodeImages(tasks, encodeOptions());
+    for (const EncodeResult &result : results) {
+        if (!result.error.isEmpty()) {
+            emit errorOccurred(QString("Failed to save image: %1").arg(result.error));
+        }
+    }
+    return results;
+}
+
+int ImageProcessor::saveImages(const QString &basePath, const QList<QImage> &images)
+{
+    const QList<OutputFormat> formats = outputFormats();
+    QList<EncodeTask> tasks;
+    for (const QImage &image : images) {
+        QString suffix = QString("_%1x%2").arg(image.width()).arg(image.height());
+        for (OutputFormat format : formats) {
+            tasks.append({image, outputFilePath(basePath, suffix, format), format});
+        }
+    }
+    
+    int written = 0;
+    for (const EncodeResult &result : encodeImages(tasks, encodeOptions())) {
+        if (result.error.isEmpty()) {
+            ++written;
+        } else {
+            emit errorOccurred(QString("Failed to save image: %1").arg(result.error));
+        }
+    }
+    
+    return written;
+}
+
+QList<ImageProcessor::EncodeResult> ImageProcessor::encodeImages(const QList<EncodeTask> &tasks,
+                                                                 const EncodeOptions &options,
+                                                                 const std::function<void(int encoded)> &onEncoded)
+{
+    // Encoders are single threaded, so run one per file
+    QList<EncodeResult> results(tasks.size());
+    QMutex mutex;
+    int encoded = 0;
+    QThreadPool pool;
+    
+    for (int i = 0; i < tasks.size(); ++i) {
+        const EncodeTask task = tasks[i];
+        EncodeResult *result = &results[i];
+        pool.start([&mutex, &encoded, &onEncoded, task, result, options]() {
+            *result = encodeFile(task, options);
             
-            line[x] = qRgba(r, g, b, qAlpha(pixel));
+            QMutexLocker locker(&mutex);
+            ++encoded;
+            if (onEncoded) {
+                onEncoded(encoded);
+            }
+        });
+    }
+    pool.waitForDone();
+    
+    return results;
+}
+
+ImageProcessor::EncodeResult ImageProcessor::encodeFile(const EncodeTask &task, const EncodeOptions &options)
+{
+    TRACE_SCOPE("ImageProcessor::encodeFile");
+    QElapsedTimer timer;
+    timer.start();
+    
+    EncodeResult result;
+    result.path = task.path;
+    result.format = task.format;
+    result.bytes = 0;
+    result.quality = -1;
+    result.trials = 1;
+    
+    const bool hasQuality = (task.format == OutputFormat::JPEG || task.format == OutputFormat::WEBP);
+    QString error;
+    bool ok = false;
+    
+    if (hasQuality && options.maxFileBytes > 0) {
+        QByteArray data = encodeToSize(task.image, task.format, options, &result.quality, &result.trials, &error);
+        if (!data.isEmpty()) {
+            QFile file(task.path);
+            ok = file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+            if (ok) {
+                result.bytes = data.size();
+            } else {
+                error = file.errorString();
+            }
+        }
+    } else {
+        ok = encodeImage(task.image, task.path, task.format, options, &error);
+        if (ok) {
+            result.bytes = QFileInfo(task.path).size();
+            result.quality = hasQuality ? options.quality : -1;
         }
     }
     
+    if (!ok) {
+        result.error = QString("%1: %2").arg(QFileInfo(task.path).fileName(), error);
+    }
+    result.elapsedMs = timer.elapsed();
     return result;
 }
 
-void ImageProcessor::setOutputFormat(OutputFormat format)
+QByteArray ImageProcessor::encodeToSize(const QImage &image, OutputFormat format, const EncodeOptions &options,
+                                        int *quality, int *trials, QString *errorString)
 {
-    m_outputFormat = format;
+    TRACE_SCOPE("ImageProcessor::encodeToSize");
+    const qint64 maxBytes = options.maxFileBytes;
+    const QByteArray writerFormat = (format == OutputFormat::WEBP) ? "webp" : "jpg";
+    
+    // Qualities strictly between low and high are still open: low is known
+    // to fit (0 while nothing does) and high is known not to
+    int low = 0;
+    int high = qBound(1, options.quality, 100) + 1;
+    QByteArray best;
+    int count = 0;
+    
+    // File size grows with quality, so each round of n concurrent encodes
+    // narrows the open range about n-fold where bisection would halve it.
+    // Helpers come from the shared global pool and only when a thread is
+    // idle there, so calls from several export workers at once never add
+    // more threads than the machine has; the caller encodes the rest.
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const int maxWidth = qBound(1, ParallelFor::threadCount(), 4);
+    
+    while (high - low > 1) {
+        const int idle = qMax(0, pool->maxThreadCount() - pool->activeThreadCount());
+        const int n = qMin(qMin(maxWidth, idle + 1), high - low - 1);
+        
+        // The first round always includes the top of the range, so it
+        // settles on maxQuality straight away when that fits; later rounds
+        // split the open range evenly, which with one encode is bisection
+        QList<int> candidates;
+        for (int i = 0; i < n; ++i) {
+            candidates << (count == 0 ? low + (high - 1 - low) * (i + 1) / n
+                                      : low + (high - low) * (i + 1) / (n + 1));
+        }
+        
+        QList<QByteArray> encoded(n);
+        QStringList errors(n);
+        std::atomic<int> next(0);
+        auto encodeCandidates = [&]() {
+            for (int i = next++; i < n; i = next++) {
+                QBuffer buffer(&encoded[i]);
+                buffer.open(QIODevice::WriteOnly);
+                QImageWriter writer(&buffer, writerFormat);
+                configureWriter(&writer, format, options, candidates[i]);
+                if (!writer.write(image)) {
+                    errors[i] = writer.errorString();
+                    encoded[i].clear();
+                }
+            }
+        };
+        
+        QSemaphore helpersDone;
+        int helpers = 0;
+        for (int i = 1; i < n; ++i) {
+            if (pool->tryStart([&encodeCandidates, &helpersDone]() {
+                    encodeCandidates();
+                    helpersDone.release();
+                })) {
+                ++helpers;
+            }
+        }
+        encodeCandidates();
+        helpersDone.acquire(helpers);
+        count += n;
+        
+        for (int i = 0; i < n; ++i) {
+            if (encoded[i].isEmpty()) {
+                if (errorString) {
+                    *errorString = errors[i];
+                }
+                return QByteArray();
+            }
+        }
+        
+        // Lowest quality over the limit closes the range from above; the
+        // highest quality below it that fits closes it from below
+        for (int i = 0; i < n; ++i) {
+            if (encoded[i].size() > maxBytes) {
+                high = candidates[i];
+                break;
+            }
+        }
+        for (int i = n - 1; i >= 0; --i) {
+            if (candidates[i] < high && encoded[i].size() <= maxBytes) {
+                if (candidates[i] > low) {
+                    low = candidates[i];
+                    best = encoded[i];
+                }
+                break;
+            }
+        }
+    }
+    
+    if (quality) {
+        *quality = low;
+    }
+    if (trials) {
+        *trials = count;
+    }
+    if (best.isEmpty() && errorString) {
+        *errorString = QString("Does not fit in %1 KB even at quality 1").arg(maxBytes / 1024);
+    }
+    return best;
 }
 
-void ImageProcessor::setJpegQuality(int quality)
+QString ImageProcessor::encodeSummary(const QList<EncodeResult> &results)
 {
-    m_jpegQuality = qBound(1, quality, 100);
+    // Totals per format, in the order the formats first appear
+    QList<OutputFormat> order;
+    QMap<OutputFormat, qint64> milliseconds;
+    QMap<OutputFormat, qint64> bytes;
+    QMap<OutputFormat, int> files;
+    QMap<OutputFormat, int> trials;
+    QMap<OutputFormat, int> lowestQuality;
+    for (const EncodeResult &result : results) {
+        if (!result.error.isEmpty()) {
+            continue;
+        }
+        if (!order.contains(result.format)) {
+            order << result.format;
+            lowestQuality[result.format] = result.quality;
+        }
+        milliseconds[result.format] += result.elapsedMs;
+        bytes[result.format] += result.bytes;
+        files[result.format] += 1;
+        trials[result.format] += result.trials;
+        lowestQuality[result.format] = qMin(lowestQuality[result.format], result.quality);
+    }
+    
+    QStringList parts;
+    for (OutputFormat format : order) {
+        QString part = QString("%1 %2 ms, %3 KB")
+                       .arg(formatTable().value(format).extension.toUpper())
+                       .arg(milliseconds[format])
+                       .arg((bytes[format] + 1023) / 1024);
+        if (trials[format] > files[format]) {
+            part += QString(", quality %1 after %2 trial encodes").arg(lowestQuality[format]).arg(trials[format]);
+        }
+        parts << part;
+    }
+    return parts.join("; ");
 }
 
-QImage ImageProcessor::cropAndScale(const QImage &image, const QSize &targetSize, const QRect &cropRect) const
+ExportQueue *ImageProcessor::exportQueue()
 {
-    // First crop the image
-    QImage cropped = image.copy(cropRect);
+    if (!m_exportQueue) {
+        m_exportQueue = new ExportQueue(this);
+        connect(m_exportQueue, &ExportQueue::progressChanged, this, &ImageProcessor::exportProgress);
+        connect(m_exportQueue, &ExportQueue::jobFinished, this, &ImageProcessor::exportFinished);
+        connect(m_exportQueue, &ExportQueue::jobFailed, this, &ImageProcessor::errorOccurred);
+        connect(m_exportQueue, &ExportQueue::idle, this, &ImageProcessor::exportsIdle);
+        connect(m_exportQueue, &ExportQueue::jobTimed, this, [this](qint64 renderMs, qint64 encodeMs) {
+            m_performance.renderMs = renderMs;
+            m_performance.encodeMs = encodeMs;
+        });
+    }
+    return m_exportQueue;
+}
+
+void ImageProcessor::queueWallpaper(const QString &basePath, const QSize &targetSize, const QRect &cropRect)
+{
+    const RenderSource source = renderSource();
+    const QString suffix = QString("_%1x%2").arg(targetSize.width()).arg(targetSize.height());
+    QList<EncodeTask> tasks;
+    for (OutputFormat format : outputFormats()) {
+        tasks.append({QImage(), outputFilePath(basePath, suffix, format), format});
+    }
+    const EncodeOptions options = encodeOptions();
     
-    // Then scale to target size
-    return cropped.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    exportQueue()->enqueue([source, targetSize, cropRect, tasks, options](const ExportQueue::Progress &progress) {
+        ExportQueue::Outcome outcome;
+        QElapsedTimer timer;
+        timer.start();
+        QString error;
+        QImage image = renderSnapshot(source, targetSize, cropRect, &error);
+        outcome.renderMs = timer.restart();
+        if (image.isNull()) {
+            outcome.errors << QString("Failed to render wallpaper: %1").arg(error);
+            return outcome;
+        }
+        
+        // Rendered once, then encoded to every format concurrently.
+        // Resampling is usually the quicker half; encoding fills the rest.
+        progress(0.5);
+        QList<EncodeTask> encodes = tasks;
+        for (EncodeTask &task : encodes) {
+            task.image = image;
+        }
+        const int count = encodes.size();
+        QList<EncodeResult> results = encodeImages(encodes, options, [&progress, count](int encoded) {
+            progress(0.5 + 0.5 * encoded / count);
+        });
+        outcome.encodeMs = timer.elapsed();
+        
+        for (const EncodeResult &result : results) {
+            if (!result.error.isEmpty()) {
+                outcome.errors << QString("Failed to save image: %1").arg(result.error);
+            }
+        }
+        if (outcome.errors.size() < results.size()) {
+            outcome.summary = QString("Saved %1 (%2)")
+                              .arg(QFileInfo(tasks.first().path).completeBaseName(), encodeSummary(results));
+        }
+        return outcome;
+    });
 }
 
-bool ImageProcessor::saveImage(const QString &basePath, const QString &suffix, const QImage &image)
+void ImageProcessor::queueWallpapers(const QString &basePath, const QList<QSize> &targetSizes,
+                                     const QRect &cropRect, bool verify)
 {
-    QFileInfo fileInfo(basePath);
-    QString extension = getOutputExtension(m_outputFormat);
-    QString outputPath = QString("%1/%2%3.%4")
-                        .arg(fileInfo.absolutePath())
-                        .arg(fileInfo.baseName())
-                        .arg(suffix)
-                        .arg(extension);
+    const RenderSource source = renderSource();
+    const QList<OutputFormat> formats = outputFormats();
+    const EncodeOptions options = encodeOptions();
     
-    QImageWriter writer(outputPath);
+    // Paths per target size, then per format
+    QList<QStringList> outputPaths;
+    for (const QSize &size : targetSizes) {
+        QString suffix = QString("_%1x%2").arg(size.width()).arg(size.height());
+        QStringList paths;
+        for (OutputFormat format : formats) {
+            paths << outputFilePath(basePath, suffix, format);
+        }
+        outputPaths << paths;
+    }
     
-    if (m_outputFormat == OutputFormat::JPEG) {
-        writer.setQuality(m_jpegQuality);
+    exportQueue()->enqueue([source, targetSizes, outputPaths, formats, cropRect, verify, options]
+                           (const ExportQueue::Progress &progress) {
+        ExportQueue::Outcome outcome;
+        QElapsedTimer timer;
+        timer.start();
+        QList<ExportResult> results = renderSnapshots(source, targetSizes, cropRect, verify, &outcome.errors);
+        outcome.renderMs = timer.restart();
+        progress(0.5);
+        
+        QList<EncodeTask> tasks;
+        int rendered = 0;
+        int cascaded = 0;
+        int fallbacks = 0;
+        double lowestPsnr = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < results.size(); ++i) {
+            const ExportResult &result = results[i];
+            if (result.image.isNull()) {
+                continue;
+            }
+            for (int f = 0; f < formats.size(); ++f) {
+                tasks.append({result.image, outputPaths[i][f], formats[f]});
+            }
+            ++rendered;
+            cascaded += result.cascaded ? 1 : 0;
+            if (result.verified) {
+                fallbacks += result.cascaded ? 0 : 1;
+                lowestPsnr = qMin(lowestPsnr, result.psnr);
+            }
+        }
+        
+        const int count = tasks.size();
+        QList<EncodeResult> encoded = encodeImages(tasks, options, [&progress, count](int done) {
+            progress(0.5 + 0.5 * done / count);
+        });
+        outcome.encodeMs = timer.elapsed();
+        int failed = 0;
+        for (const EncodeResult &result : encoded) {
+            if (!result.error.isEmpty()) {
+                outcome.errors << QString("Failed to save image: %1").arg(result.error);
+                ++failed;
+            }
+        }
+        
+        if (failed < count) {
+            outcome.summary = QString("Saved %1 of %2 files for %3 wallpapers, %4 resampled from a larger output")
+                              .arg(count - failed).arg(targetSizes.size() * formats.size())
+                              .arg(rendered).arg(cascaded);
+            if (verify && !std::isinf(lowestPsnr)) {
+                outcome.summary += QString(", lowest PSNR %1 dB").arg(lowestPsnr, 0, 'f', 1);
+                if (fallbacks > 0) {
+                    outcome.summary += QString(" (%1 re-rendered directly)").arg(fallbacks);
+                }
+            }
+            outcome.summary += QString(" (%1)").arg(encodeSummary(encoded));
+        }
+        return outcome;
+    });
+}
+
+void ImageProcessor::waitForExports()
+{
+    if (m_exportQueue) {
+        m_exportQueue->waitForDone();
     }
+}
+
+QString ImageProcessor::outputFilePath(const QString &basePath, const QString &suffix, OutputFormat format)
+{
+    QFileInfo fileInfo(basePath);
+    return QString("%1/%2%3.%4")
+           .arg(fileInfo.absolutePath())
+           .arg(fileInfo.baseName())
+           .arg(suffix)
+           .arg(getFormatInfo(format).extension);
+}
+
+bool ImageProcessor::encodeImage(const QImage &image, const QString &outputPath, OutputFormat format,
+                                 const EncodeOptions &options, QString *errorString)
+{
+    TRACE_SCOPE("ImageProcessor::encodeImage");
+    QImageWriter writer(outputPath);
+    configureWriter(&writer, format, options, options.quality);
     
     if (!writer.write(image)) {
-        emit errorOccurred(QString("Failed to save image: %1").arg(writer.errorString()));
+        if (errorString) {
+            *errorString = writer.errorString();
+        }
         return false;
     }
     
@@ -279,45 +1626,71 @@ bool ImageProcessor::saveImage(const QString &basePath, const QString &suffix, c
 
 QString ImageProcessor::getOutputExtension(OutputFormat format) const
 {
-    return s_outputFormats[format].extension;
+    return formatTable().value(format).extension;
 }
 
 // Static methods
 QList<ImageProcessor::Resolution> ImageProcessor::getSupportedResolutions()
 {
-    ImageProcessor temp; // Ensure static data is initialized
-    return s_resolutions;
+    return resolutionTable();
 }
 
 QMap<QString, ImageProcessor::OutputFormat> ImageProcessor::getDefaultOutputMapping()
 {
-    ImageProcessor temp; // Ensure static data is initialized
-    return s_defaultMapping;
+    return defaultMappingTable();
 }
 
 ImageProcessor::FormatInfo ImageProcessor::getFormatInfo(OutputFormat format)
 {
-    ImageProcessor temp; // Ensure static data is initialized
-    return s_outputFormats[format];
+    return formatTable().value(format);
+}
+
+bool ImageProcessor::isOutputFormatAvailable(OutputFormat format)
+{
+    // BMP, JPEG, PNG and TIFF ship with Qt; WebP needs the imageformats plugin
+    return QImageWriter::supportedImageFormats().contains(getFormatInfo(format).extension.toLatin1());
+}
+
+QList<ImageProcessor::OutputFormat> ImageProcessor::getAvailableOutputFormats()
+{
+    QList<OutputFormat> formats;
+    for (OutputFormat format : {OutputFormat::PNG, OutputFormat::JPEG, OutputFormat::WEBP,
+                                OutputFormat::TIFF, OutputFormat::BMP}) {
+        if (isOutputFormatAvailable(format)) {
+            formats << format;
+        }
+    }
+    return formats;
+}
+
+QString ImageProcessor::encoderSpeedName(EncoderSpeed speed)
+{
+    switch (speed) {
+    case EncoderSpeed::Fast:
+        return "Fast";
+    case EncoderSpeed::Balanced:
+        return "Balanced";
+    case EncoderSpeed::Smallest:
+        return "Smallest";
+    }
+    return QString();
 }
 
 bool ImageProcessor::isFormatSupported(const QString &extension)
 {
-    ImageProcessor temp; // Ensure static data is initialized
-    return s_defaultMapping.contains(extension.toLower());
+    return defaultMappingTable().contains(extension.toLower());
 }
 
 QStringList ImageProcessor::getSupportedInputExtensions()
 {
-    ImageProcessor temp; // Ensure static data is initialized
-    return s_defaultMapping.keys();
+    return defaultMappingTable().keys();
 }
 
 QStringList ImageProcessor::getSupportedOutputExtensions()
 {
-    ImageProcessor temp; // Ensure static data is initialized
+    const QMap<OutputFormat, FormatInfo> &formats = formatTable();
     QStringList extensions;
-    for (auto it = s_outputFormats.begin(); it != s_outputFormats.end(); ++it) {
+    for (auto it = formats.begin(); it != formats.end(); ++it) {
         extensions << it.value().extension;
     }
     return extensions;
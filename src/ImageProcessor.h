@@ -9,10 +9,20 @@
 
 #include <QObject>
 #include <QImage>
-#include <QPixmap>
 #include <QString>
 #include <QSize>
 #include <QMap>
+#include <QMutex>
+#include <QThreadPool>
+#include "Resampler.h"
+#include "ExportQueue.h"
+#include "DecodedImageCache.h"
+#include "ThumbnailCache.h"
+#include <QTimer>
+#include <functional>
+#include <atomic>
+
+class QImageWriter;
 
 class ImageProcessor : public QObject
 {
@@ -23,7 +33,24 @@ public:
         PNG,
         JPEG,
         BMP,
-        TIFF
+        TIFF,
+        WEBP     // Only when the Qt WebP image plugin is installed
+    };
+    
+    // Encoder effort, traded against file size
+    enum class EncoderSpeed {
+        Fast,
+        Balanced,
+        Smallest
+    };
+    
+    // QImageWriter parameters for one speed; -1 keeps the writer default,
+    // or for quality the user's setting
+    struct EncoderParameters {
+        int quality;
+        int compression;
+        bool optimizedWrite;
+        bool progressiveScanWrite;
     };
 
     struct FormatInfo {
@@ -31,6 +58,7 @@ public:
         QString description;
         bool supportsQuality;
         bool supportsTransparency;
+        QList<EncoderParameters> speedPresets; // Indexed by EncoderSpeed, empty if speed has no effect
     };
 
     struct Resolution {
@@ -43,16 +71,128 @@ public:
         Resolution(int w, int h, const QString &n, const QString &d, bool vertical = false)
             : width(w), height(h), name(n), description(d), isVertical(vertical) {}
     };
+    
+    // One output of a multi-resolution export
+    struct ExportResult {
+        QSize size;
+        QImage image;
+        QSize resampledFrom;  // Size of the crop or intermediate it was resampled from
+        bool cascaded;        // Resampled from a larger output rather than the crop
+        bool verified;        // Compared against direct resampling
+        double psnr;          // Against direct resampling, in dB; infinite if identical
+    };
+    
+    // One file of an export; the encodes of a save run concurrently
+    struct EncodeTask {
+        QImage image;
+        QString path;
+        OutputFormat format;
+    };
+    struct EncodeResult {
+        QString path;
+        OutputFormat format;
+        qint64 bytes;
+        qint64 elapsedMs;
+        int quality;          // -1 for formats without one
+        int trials;           // Encodes made, more than one after a size search
+        QString error;        // Empty on success
+    };
+    
+    // With a file size limit, JPEG and WebP search for the highest quality up
+    // to quality that fits; other formats ignore the limit
+    struct EncodeOptions {
+        int quality;
+        qint64 maxFileBytes;  // 0 for no limit
+        QMap<OutputFormat, EncoderSpeed> speeds; // Balanced when missing
+    };
+    
+    // One entry of a memory report
+    struct BufferUsage {
+        QString name;
+        QSize size;           // Empty for pooled buffers such as caches
+        qint64 bytes;
+        bool shared;          // Pixels belong to an entry listed before it
+    };
+    
+    // Durations of the most recent operations, -1 until one has run
+    struct PerformanceStats {
+        qint64 decodeMs;      // Last load, on the worker
+        qint64 adjustMs;      // Last adjustment preview pass
+        qint64 renderMs;      // Last background save: crop, resample and adjust
+        qint64 encodeMs;      // Last background save: all of its files
+    };
+    
+    // Minimum PSNR a cascaded output must reach against direct resampling
+    static constexpr double CascadeMinPsnr = 40.0;
+    
+    static constexpr int DefaultMemoryBudgetMB = 1024;
+    static constexpr int MaxMemoryBudgetMB = 256 * 1024;
+    static constexpr int DefaultDecodeCacheMB = 512;
+    static constexpr int DefaultPrefetchDepth = 1;
+    static constexpr int DefaultPrefetchMemoryMB = 512;
+    static constexpr int DefaultProxyCacheMB = 1024;
 
     explicit ImageProcessor(QObject *parent = nullptr);
+    ~ImageProcessor() override;
 
-    // Image loading and format detection
+    // Image loading and format detection. Decoding runs on a worker thread and
+    // finishes with imageLoaded or loadFailed; a newer request discards
+    // the result of any decode still in flight. Asking again for the image
+    // already loading does nothing, and an image the prefetch thread is
+    // decoding is taken from it rather than decoded twice.
     bool loadImage(const QString &filePath);
+    bool isLoading() const { return m_loading; }
+    static QImage decodeImage(const QString &filePath, QString *errorString = nullptr);
+    
+    // Decodes only clipRect of the file, reduced by the largest power of two
+    // (up to 1/8) that keeps it at least minimumSize. Handlers that clip and
+    // scale while decoding, like JPEG's DCT scaling, never produce the full
+    // image. decodedRect receives the source area the result covers.
+    static QImage decodeRegion(const QString &filePath, const QRect &clipRect, const QSize &minimumSize,
+                               QRect *decodedRect = nullptr, QString *errorString = nullptr);
     QString detectInputFormat(const QString &filePath);
-    QImage getCurrentImage() const { return m_currentImage; }
-    QPixmap getCurrentPixmap() const { return QPixmap::fromImage(m_currentImage); }
+    // The adjusted preview while adjustments are active, otherwise the source
+    QImage getCurrentImage() const { return m_adjustedPreview.isNull() ? m_sourceImage : m_adjustedPreview; }
+    QSize getImageSize() const { return m_sourceSize; }
+    QList<BufferUsage> memoryUsage() const; // Image buffers currently held
+    PerformanceStats performanceStats() const { return m_performance; }
     
-    // Image adjustments
+    // Images whose decoded pixels exceed the memory budget, or Qt's reader
+    // allocation limit, are shown from a reduced proxy and exported by
+    // streaming the file in strips
+    void setMemoryBudgetMB(int megabytes);
+    int memoryBudgetMB() const { return static_cast<int>(m_memoryBudget / (1024 * 1024)); }
+    // Qt's allocation limit covers every reader in the process, so only the
+    // application sets it, to its configured budget; until then Qt's default
+    // applies. Images over it are never decoded whole.
+    static void setReaderAllocationLimit(int megabytes);
+    static bool exceedsReaderAllocationLimit(const QSize &size, QImage::Format format = QImage::Format_Invalid);
+    bool isStreaming() const { return m_streaming; }
+    static QImage streamResample(const QString &filePath, const QRectF &sourceRect, const QSize &targetSize,
+                                 Resampler::Filter filter, qint64 memoryBudget, QString *errorString = nullptr);
+    
+    // Recently loaded images are kept decoded, so reopening one is instant
+    // while the file is unchanged. 0 disables the cache.
+    void setDecodeCacheMB(int megabytes);
+    int decodeCacheMB() const { return static_cast<int>(m_decodeCache.budget() / (1024 * 1024)); }
+    DecodedImageCache::Stats decodeCacheStats() const { return m_decodeCache.stats(); }
+    
+    // Decodes files into the cache on a low-priority thread, nearest first,
+    // until their estimated size reaches the prefetch memory cap. Files
+    // still queued from an earlier call are dropped.
+    void prefetch(const QStringList &filePaths);
+    void setPrefetchMemoryMB(int megabytes);
+    int prefetchMemoryMB() const { return static_cast<int>(m_prefetchMemory / (1024 * 1024)); }
+    
+    // Screen-sized proxies of opened images kept on disk. While an image
+    // with a stored proxy decodes, proxyLoaded delivers the proxy first.
+    // 0 disables the cache.
+    void setProxyCacheMB(int megabytes);
+    int proxyCacheMB() const { return static_cast<int>(m_proxyCache.budget() / (1024 * 1024)); }
+    
+    // Image adjustments. Slider changes are coalesced and rendered on a worker
+    // thread at preview resolution; getCurrentImage() returns that preview
+    // once imageProcessed fires. Full resolution is only rendered on export.
     void setBrightness(int brightness); // -100 to 100
     void setContrast(int contrast);     // -100 to 100
     void setSaturation(int saturation); // -100 to 100
@@ -60,34 +200,124 @@ public:
     
     // Output format handling
     void setOutputFormat(OutputFormat format);
-    void setJpegQuality(int quality); // 1-100
+    void setJpegQuality(int quality); // 1-100, also used for WebP
+    void setAdditionalFormats(const QList<OutputFormat> &formats);
+    void setMaxFileSizeKB(int kilobytes); // 0 for no limit
+    void setEncoderSpeed(OutputFormat format, EncoderSpeed speed);
+    EncoderSpeed getEncoderSpeed(OutputFormat format) const;
+    int getMaxFileSizeKB() const { return m_maxFileSizeKB; }
     OutputFormat getOutputFormat() const { return m_outputFormat; }
+    QList<OutputFormat> getAdditionalFormats() const { return m_additionalFormats; }
+    QList<OutputFormat> outputFormats() const; // Output format first, without duplicates
     int getJpegQuality() const { return m_jpegQuality; }
     
     // Cropping and scaling
-    QImage cropAndScale(const QImage &image, const QSize &targetSize, const QRect &cropRect) const;
+    static QImage cropAndScale(const QImage &image, const QSize &targetSize, const QRect &cropRect,
+                               Resampler::Filter filter = Resampler::Filter::Lanczos3);
+    static QRect centerCropRect(const QSize &imageSize, const QSize &targetSize);
+    
+    // Export pipeline: crop and resample the original, then adjust at output size.
+    // Streamed images give the same pixels as if they had been fully loaded.
+    QImage renderWallpaper(const QSize &targetSize, const QRect &cropRect);
+    static QImage renderWallpaper(const QImage &source, const QSize &targetSize, const QRect &cropRect,
+                                  int brightness, int contrast, int saturation);
+    
+    // Renders several resolutions from one crop. Each output is the largest
+    // centered rect of its aspect ratio within cropRect, resampled from the
+    // nearest larger output covering it. With verify set, cascaded outputs
+    // falling below CascadeMinPsnr are replaced by direct resamples. Streamed
+    // images render each output straight from the file instead.
+    QList<ExportResult> renderWallpapers(const QList<QSize> &targetSizes, const QRect &cropRect,
+                                         bool verify);
+    static double computePsnr(const QImage &a, const QImage &b);
     
-    // File operations
+    // File operations. Every image is written in the output format plus the
+    // additional formats, encoding all files in parallel.
     bool saveImage(const QString &basePath, const QString &suffix, const QImage &image);
+    QList<EncodeResult> saveImage(const QString &basePath, const QString &suffix, const QImage &image,
+                                  const QList<OutputFormat> &formats);
+    int saveImages(const QString &basePath, const QList<QImage> &images); // Returns files written
     QString getOutputExtension(OutputFormat format) const;
     
+    // Background export. The image, adjustments and output settings are
+    // captured when a save is queued; rendering and encoding then run on the
+    // export queue while the GUI stays responsive. Progress arrives through
+    // exportProgress, each finished save through exportFinished, and
+    // failures through errorOccurred.
+    void queueWallpaper(const QString &basePath, const QSize &targetSize, const QRect &cropRect);
+    void queueWallpapers(const QString &basePath, const QList<QSize> &targetSizes, const QRect &cropRect,
+                         bool verify);
+    int pendingExports() const { return m_exportQueue ? m_exportQueue->pendingCount() : 0; }
+    void waitForExports();
+    
+    // Thread-safe encoding helpers shared with the batch mode
+    static QString outputFilePath(const QString &basePath, const QString &suffix, OutputFormat format);
+    static bool encodeImage(const QImage &image, const QString &outputPath, OutputFormat format,
+                            const EncodeOptions &options, QString *errorString = nullptr);
+    static EncodeResult encodeFile(const EncodeTask &task, const EncodeOptions &options);
+    static QList<EncodeResult> encodeImages(const QList<EncodeTask> &tasks, const EncodeOptions &options,
+                                            const std::function<void(int encoded)> &onEncoded = nullptr);
+    
+    // Highest quality up to options.quality whose encoding fits in
+    // options.maxFileBytes, found by testing several qualities at once per
+    // round into memory buffers. Returns the encoded file, or an empty array
+    // if even quality 1 is too big.
+    static QByteArray encodeToSize(const QImage &image, OutputFormat format, const EncodeOptions &options,
+                                   int *quality, int *trials, QString *errorString = nullptr);
+    static QString encodeSummary(const QList<EncodeResult> &results); // Time and size per format
+    
     // Static utility methods
     static QList<Resolution> getSupportedResolutions();
     static QMap<QString, OutputFormat> getDefaultOutputMapping();
     static FormatInfo getFormatInfo(OutputFormat format);
     static bool isFormatSupported(const QString &extension);
+    static bool isOutputFormatAvailable(OutputFormat format); // A writer plugin is installed
+    static QList<OutputFormat> getAvailableOutputFormats(); // Installed writers, in menu order
+    static QString encoderSpeedName(EncoderSpeed speed);
     static QStringList getSupportedInputExtensions();
     static QStringList getSupportedOutputExtensions();
 
 signals:
+    void loadStarted(const QString &filePath);
+    void proxyLoaded(const QString &filePath, const QImage &proxy, const QSize &sourceSize);
     void imageLoaded(const QString &filePath);
+    void loadFailed(const QString &filePath, const QString &error); // The previous image stays current
     void imageProcessed();
     void errorOccurred(const QString &error);
+    void exportProgress(int percent);
+    void exportFinished(const QString &summary);
+    void exportsIdle();
 
 private:
-    QImage m_originalImage;
-    QImage m_currentImage;
+    // The only full-resolution buffer; a reduced proxy when streaming
+    QImage m_sourceImage;
     QString m_currentFilePath;
+    QSize m_sourceSize;
+    bool m_streaming;
+    std::atomic<qint64> m_memoryBudget;
+    
+    // Background loading
+    QThreadPool *m_loadPool;
+    std::atomic<quint64> m_loadGeneration;
+    bool m_loading;
+    QString m_loadingPath;
+    DecodedImageCache m_decodeCache;
+    ThumbnailCache m_proxyCache;
+    
+    // Background decoding of images likely to be opened next
+    QThreadPool *m_prefetchPool;
+    std::atomic<quint64> m_prefetchGeneration;
+    qint64 m_prefetchMemory;
+    QMutex m_prefetchMutex;     // Guards the two below and cache inserts by prefetches
+    QString m_prefetchingPath;  // Being decoded by the prefetch thread
+    quint64 m_prefetchAdopter;  // Load generation waiting for that decode, or 0
+    
+    // Live preview
+    QImage m_previewBase;      // Shares m_sourceImage when already small
+    QImage m_adjustedPreview;  // Null while no adjustment is active
+    QTimer *m_previewTimer;
+    QThreadPool *m_previewPool;
+    std::atomic<quint64> m_previewGeneration;
     
     // Image adjustments
     int m_brightness;
@@ -96,17 +326,62 @@ private:
     
     // Output settings
     OutputFormat m_outputFormat;
+    QList<OutputFormat> m_additionalFormats;
     int m_jpegQuality;
+    int m_maxFileSizeKB;
+    QMap<OutputFormat, EncoderSpeed> m_encoderSpeeds;
+    
+    // Background export
+    ExportQueue *m_exportQueue;
     
-    // Static data
-    static QList<Resolution> s_resolutions;
-    static QMap<OutputFormat, FormatInfo> s_outputFormats;
-    static QMap<QString, OutputFormat> s_defaultMapping;
+    PerformanceStats m_performance;
     
-    void initializeStaticData();
+    // What an export renders from, captured so it can run off the GUI thread
+    struct RenderSource {
+        QImage image;        // Null when streaming from filePath
+        QString filePath;
+        qint64 memoryBudget;
+        int brightness;
+        int contrast;
+        int saturation;
+    };
+    
+    // Static data, built on first use
+    static const QList<Resolution> &resolutionTable();
+    static const QMap<OutputFormat, FormatInfo> &formatTable();
+    static const QMap<QString, OutputFormat> &defaultMappingTable();
+    
+    void finishLoad(quint64 generation, const QString &filePath, const QImage &image,
+                    const QImage &preview, const QSize &sourceSize, qint64 decodeMs, const QString &error);
+    void finishProxy(quint64 generation, const QString &filePath, const QImage &proxy, const QSize &sourceSize);
+    static QImage decodeProxy(const QString &filePath, const QSize &sourceSize, qint64 memoryBudget,
+                              QString *errorString);
+    // What loadImage shows: the full image or a proxy, plus the preview base
+    static DecodedImageCache::Entry decodeForDisplay(const QString &filePath, qint64 memoryBudget,
+                                                     QString *errorString);
+    void storeProxy(const QString &filePath, const DecodedImageCache::Entry &entry); // Any thread
+    RenderSource renderSource() const;
+    EncodeOptions encodeOptions() const;
+    static void configureWriter(QImageWriter *writer, OutputFormat format, const EncodeOptions &options,
+                                int quality);
+    ExportQueue *exportQueue();
+    static QImage renderSnapshot(const RenderSource &source, const QSize &targetSize, const QRect &cropRect,
+                                 QString *errorString);
+    static QList<ExportResult> renderSnapshots(const RenderSource &source, const QList<QSize> &targetSizes,
+                                               const QRect &cropRect, bool verify, QStringList *errors);
+    static QList<ExportResult> renderCascade(const QImage &original, const QList<QSize> &targetSizes,
+                                             const QRect &cropRect, bool verify);
+    void schedulePreview();
+    void renderPreview();
+    void finishPreview(quint64 generation, const QImage &preview, qint64 adjustMs);
     QImage adjustBrightness(const QImage &image, int brightness) const;
     QImage adjustContrast(const QImage &image, int contrast) const;
     QImage adjustSaturation(const QImage &image, int saturation) const;
+    
+    // Single-pass kernel shared by applyAdjustments and the adjust* helpers.
+    // Returns a null image if isCancelled reports true part way through.
+    static QImage adjustPixels(const QImage &image, int brightness, int contrast, int saturation,
+                               const std::function<bool()> &isCancelled = nullptr);
 };
 
 #endif // IMAGEPROCESSOR_H
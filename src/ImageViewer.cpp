@@ -5,7 +5,7 @@
 //  See the LICENSE file for full details
 //===========================================
 #include "ImageViewer.h"
-#include <QGraphicsPixmapItem>
+#include "Trace.h"
 #include <QGraphicsScene>
 #include <QWheelEvent>
 #include <QMouseEvent>
@@ -20,18 +20,21 @@
 #include <QScrollBar>
 #include <QApplication>
 #include <QDebug>
+#include <algorithm>
 #include <cmath>
 
 ImageViewer::ImageViewer(QWidget *parent)
     : QGraphicsView(parent)
     , m_scene(nullptr)
-    , m_pixmapItem(nullptr)
+    , m_imageItem(nullptr)
     , m_panning(false)
     , m_scaleFactor(1.0)
     , m_minScaleFactor(0.1)
     , m_maxScaleFactor(10.0)
     , m_showCropOverlay(false)
+    , m_lastFrameMs(0.0)
 {
+    m_frameClock.start();
     setupScene();
     setAcceptDrops(true);
     setDragMode(QGraphicsView::NoDrag);
@@ -55,19 +58,20 @@ void ImageViewer::setupScene()
     connect(m_scene, &QGraphicsScene::changed, this, &ImageViewer::onSceneChanged);
 }
 
-void ImageViewer::setImage(const QPixmap &pixmap)
+void ImageViewer::setImage(const QImage &image, const QSize &sourceSize)
 {
+    TRACE_SCOPE("ImageViewer::setImage");
     clearImage();
     
-    if (pixmap.isNull()) {
+    if (image.isNull()) {
         return;
     }
     
-    m_pixmapItem = m_scene->addPixmap(pixmap);
-    m_pixmapItem->setTransformationMode(Qt::SmoothTransformation);
+    m_imageItem = new TiledImageItem(image, sourceSize);
+    m_scene->addItem(m_imageItem);
     
     // Set a larger scene rect to allow full panning
-    QRect imageRect = pixmap.rect();
+    QRect imageRect = m_imageItem->boundingRect().toRect();
     int margin = qMax(imageRect.width(), imageRect.height());
     QRect expandedRect = imageRect.adjusted(-margin, -margin, margin, margin);
     m_scene->setSceneRect(expandedRect);
@@ -77,12 +81,22 @@ void ImageViewer::setImage(const QPixmap &pixmap)
     emit viewChanged();
 }
 
+void ImageViewer::updateImage(const QImage &image, const QSize &sourceSize)
+{
+    TRACE_SCOPE("ImageViewer::updateImage");
+    if (!hasImage() || image.isNull()) {
+        return;
+    }
+    
+    m_imageItem->setImage(image, sourceSize);
+}
+
 void ImageViewer::clearImage()
 {
-    if (m_pixmapItem) {
-        m_scene->removeItem(m_pixmapItem);
-        delete m_pixmapItem;
-        m_pixmapItem = nullptr;
+    if (m_imageItem) {
+        m_scene->removeItem(m_imageItem);
+        delete m_imageItem;
+        m_imageItem = nullptr;
     }
     
     m_scene->clear();
@@ -157,7 +171,7 @@ void ImageViewer::fitToWindow()
         return;
     }
     
-    fitInView(m_pixmapItem, Qt::KeepAspectRatio);
+    fitInView(m_imageItem, Qt::KeepAspectRatio);
     m_scaleFactor = transform().m11();
     emit viewChanged();
 }
@@ -212,8 +226,9 @@ void ImageViewer::scaleView(qreal scaleFactor)
         return;
     }
     
+    // Very large sources fit the window below the usual minimum zoom
     qreal newScale = m_scaleFactor * scaleFactor;
-    newScale = qBound(m_minScaleFactor, newScale, m_maxScaleFactor);
+    newScale = qBound(qMin(m_minScaleFactor, m_scaleFactor), newScale, m_maxScaleFactor);
     
     if (qAbs(newScale - m_scaleFactor) < 0.001) {
         return; // No significant change
@@ -233,7 +248,7 @@ void ImageViewer::centerImage()
         return;
     }
     
-    centerOn(m_pixmapItem);
+    centerOn(m_imageItem);
 }
 
 QRect ImageViewer::getImageBounds() const
@@ -242,7 +257,7 @@ QRect ImageViewer::getImageBounds() const
         return QRect();
     }
     
-    return m_pixmapItem->boundingRect().toRect();
+    return m_imageItem->sceneBoundingRect().toRect();
 }
 
 void ImageViewer::wheelEvent(QWheelEvent *event)
@@ -347,12 +362,28 @@ void ImageViewer::dropEvent(QDropEvent *event)
 
 void ImageViewer::paintEvent(QPaintEvent *event)
 {
+    const qint64 start = m_frameClock.nsecsElapsed();
+    
     QGraphicsView::paintEvent(event);
     
     if (m_showCropOverlay && hasImage() && !m_cropRect.isEmpty()) {
         QPainter painter(viewport());
         drawCropOverlay(&painter);
     }
+    
+    m_lastFrameMs = (m_frameClock.nsecsElapsed() - start) / 1e6;
+    m_frameTimes.append(start);
+    while (m_frameTimes.first() < start - 1000000000LL) {
+        m_frameTimes.removeFirst();
+    }
+}
+
+int ImageViewer::framesPerSecond() const
+{
+    const qint64 since = m_frameClock.nsecsElapsed() - 1000000000LL;
+    return static_cast<int>(std::count_if(m_frameTimes.begin(), m_frameTimes.end(), [since](qint64 time) {
+        return time >= since;
+    }));
 }
 
 void ImageViewer::drawCropOverlay(QPainter *painter)
@@ -3,7 +3,6 @@
 
 #include <QGraphicsView>
 #include <QGraphicsScene>
-#include <QGraphicsPixmapItem>
 #include <QWheelEvent>
 #include <QMouseEvent>
 #include <QDragEnterEvent>
@@ -21,6 +20,9 @@
 #include <QBrush>
 #include <QRect>
 #include <QSize>
+#include <QElapsedTimer>
+#include <QList>
+#include "TiledImageItem.h"
 
 class ImageViewer : public QGraphicsView
 {
@@ -29,10 +31,22 @@ class ImageViewer : public QGraphicsView
 public:
     explicit ImageViewer(QWidget *parent = nullptr);
 
-    // Image management
-    void setImage(const QPixmap &pixmap);
+    // Image management. The scene is laid out in source pixels and drawn
+    // from a tile pyramid at the level that matches the zoom. A reduced
+    // proxy of a larger source is shown by passing the source size.
+    void setImage(const QImage &image, const QSize &sourceSize = QSize());
+    // Swaps the displayed pixels without touching the view, e.g. for a
+    // preview rendered at lower resolution than sourceSize
+    void updateImage(const QImage &image, const QSize &sourceSize);
     void clearImage();
-    bool hasImage() const { return m_pixmapItem != nullptr; }
+    bool hasImage() const { return m_imageItem != nullptr; }
+    qint64 pyramidBytes() const { return m_imageItem ? m_imageItem->pyramidBytes() : 0; }
+    qint64 tileCacheBytes() const { return m_imageItem ? m_imageItem->tileCacheBytes() : 0; }
+    
+    // Repaint cost of the last frame, and repaints over the last second,
+    // which falls to 0 while the view is idle
+    double lastFrameMs() const { return m_lastFrameMs; }
+    int framesPerSecond() const;
     
     // Crop overlay
     void setCropOverlay(const QSize &targetSize);
@@ -71,7 +85,7 @@ private slots:
 
 private:
     QGraphicsScene *m_scene;
-    QGraphicsPixmapItem *m_pixmapItem;
+    TiledImageItem *m_imageItem;
     
     // Pan functionality
     bool m_panning;
@@ -87,6 +101,11 @@ private:
     QSize m_cropSize;
     QRect m_cropRect;
     
+    // Frame timing
+    QElapsedTimer m_frameClock;
+    QList<qint64> m_frameTimes; // Paint start times within the last second
+    double m_lastFrameMs;
+    
     // Helper methods
     void setupScene();
     void updateCropOverlay();
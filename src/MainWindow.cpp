@@ -5,6 +5,8 @@
 //  See the LICENSE file for full details
 //===========================================
 #include "MainWindow.h"
+#include "ParallelFor.h"
+#include "Trace.h"
 #include <QApplication>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -25,10 +27,15 @@
 #include <QAction>
 #include <QActionGroup>
 #include <QCloseEvent>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QListWidget>
 #include <QStandardPaths>
 #include <QDir>
 #include <QFileInfo>
+#include <QCollator>
 #include <QDebug>
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -46,6 +53,8 @@ MainWindow::MainWindow(QWidget *parent)
     , m_formatComboBox(nullptr)
     , m_qualitySlider(nullptr)
     , m_qualityLabel(nullptr)
+    , m_maxFileSizeSpinBox(nullptr)
+    , m_maxFileSizeLabel(nullptr)
     , m_brightnessSlider(nullptr)
     , m_contrastSlider(nullptr)
     , m_saturationSlider(nullptr)
@@ -58,6 +67,8 @@ MainWindow::MainWindow(QWidget *parent)
     , m_toolBar(nullptr)
     , m_statusBar(nullptr)
     , m_progressBar(nullptr)
+    , m_performanceLabel(nullptr)
+    , m_performanceTimer(nullptr)
     , m_settings(nullptr)
     , m_settingsDialog(nullptr)
     , m_imageLoaded(false)
@@ -183,9 +194,24 @@ void MainWindow::setupFormatComboBox()
     m_formatComboBox->addItem("JPEG (Compressed)", static_cast<int>(ImageProcessor::OutputFormat::JPEG));
     m_formatComboBox->addItem("BMP (Uncompressed)", static_cast<int>(ImageProcessor::OutputFormat::BMP));
     m_formatComboBox->addItem("TIFF (Professional)", static_cast<int>(ImageProcessor::OutputFormat::TIFF));
+    if (ImageProcessor::isOutputFormatAvailable(ImageProcessor::OutputFormat::WEBP)) {
+        m_formatComboBox->addItem("WebP (Compressed)", static_cast<int>(ImageProcessor::OutputFormat::WEBP));
+    }
     
     layout->addWidget(m_formatComboBox);
     
+    // Formats written alongside the one above, from the same rendered image
+    QHBoxLayout *additionalLayout = new QHBoxLayout();
+    additionalLayout->addWidget(new QLabel("Also save as:", this));
+    for (ImageProcessor::OutputFormat format : ImageProcessor::getAvailableOutputFormats()) {
+        QCheckBox *checkBox = new QCheckBox(ImageProcessor::getFormatInfo(format).extension.toUpper(), this);
+        checkBox->setProperty("outputFormat", static_cast<int>(format));
+        additionalLayout->addWidget(checkBox);
+        m_additionalFormatCheckBoxes << checkBox;
+    }
+    additionalLayout->addStretch();
+    layout->addLayout(additionalLayout);
+    
     // Quality slider (for JPEG)
     QHBoxLayout *qualityLayout = new QHBoxLayout();
     QLabel *qualityTextLabel = new QLabel("Quality:", this);
@@ -201,15 +227,31 @@ void MainWindow::setupFormatComboBox()
     
     layout->addLayout(qualityLayout);
     
+    // File size cap for JPEG and WebP, met by lowering the quality
+    QHBoxLayout *maxSizeLayout = new QHBoxLayout();
+    m_maxFileSizeSpinBox = new QSpinBox(this);
+    m_maxFileSizeSpinBox->setRange(0, 100 * 1024);
+    m_maxFileSizeSpinBox->setSingleStep(100);
+    m_maxFileSizeSpinBox->setSuffix(" KB");
+    m_maxFileSizeSpinBox->setSpecialValueText("No limit");
+    m_maxFileSizeSpinBox->setToolTip("JPEG and WebP files are saved at the highest quality, up to the "
+                                     "slider value, that fits in this size");
+    m_maxFileSizeLabel = new QLabel("Max file size:", this);
+    maxSizeLayout->addWidget(m_maxFileSizeLabel);
+    maxSizeLayout->addWidget(m_maxFileSizeSpinBox);
+    layout->addLayout(maxSizeLayout);
+    
     // Initially hide quality controls
     qualityTextLabel->setVisible(false);
     m_qualitySlider->setVisible(false);
     m_qualityLabel->setVisible(false);
+    m_maxFileSizeLabel->setVisible(false);
+    m_maxFileSizeSpinBox->setVisible(false);
 }
 
 void MainWindow::setupAdjustmentSliders()
 {
-    m_adjustmentsGroup = new QGroupBox("Image Adjustments (Coming Soon)", this);
+    m_adjustmentsGroup = new QGroupBox("Image Adjustments", this);
     QGridLayout *layout = new QGridLayout(m_adjustmentsGroup);
     
     // Brightness
@@ -217,7 +259,6 @@ void MainWindow::setupAdjustmentSliders()
     m_brightnessSlider = new QSlider(Qt::Horizontal, this);
     m_brightnessSlider->setRange(-100, 100);
     m_brightnessSlider->setValue(0);
-    m_brightnessSlider->setEnabled(false); // Disable for now
     layout->addWidget(m_brightnessSlider, 0, 1);
     m_brightnessLabel = new QLabel("0", this);
     m_brightnessLabel->setMinimumWidth(30);
@@ -228,7 +269,6 @@ void MainWindow::setupAdjustmentSliders()
     m_contrastSlider = new QSlider(Qt::Horizontal, this);
     m_contrastSlider->setRange(-100, 100);
     m_contrastSlider->setValue(0);
-    m_contrastSlider->setEnabled(false); // Disable for now
     layout->addWidget(m_contrastSlider, 1, 1);
     m_contrastLabel = new QLabel("0", this);
     m_contrastLabel->setMinimumWidth(30);
@@ -239,7 +279,6 @@ void MainWindow::setupAdjustmentSliders()
     m_saturationSlider = new QSlider(Qt::Horizontal, this);
     m_saturationSlider->setRange(-100, 100);
     m_saturationSlider->setValue(0);
-    m_saturationSlider->setEnabled(false); // Disable for now
     layout->addWidget(m_saturationSlider, 2, 1);
     m_saturationLabel = new QLabel("0", this);
     m_saturationLabel->setMinimumWidth(30);
@@ -247,7 +286,6 @@ void MainWindow::setupAdjustmentSliders()
     
     // Reset button
     QPushButton *resetButton = new QPushButton("Reset", this);
-    resetButton->setEnabled(false); // Disable for now
     layout->addWidget(resetButton, 3, 0, 1, 3);
     
     connect(resetButton, &QPushButton::clicked, this, &MainWindow::resetAdjustments);
@@ -263,12 +301,32 @@ void MainWindow::setupMenuBar()
     m_openAction->setStatusTip("Open an image file");
     fileMenu->addAction(m_openAction);
     
+    m_nextImageAction = new QAction("&Next Image", this);
+    m_nextImageAction->setShortcut(QKeySequence(Qt::Key_PageDown));
+    m_nextImageAction->setStatusTip("Open the next image in the same folder");
+    m_nextImageAction->setEnabled(false);
+    fileMenu->addAction(m_nextImageAction);
+    
+    m_previousImageAction = new QAction("&Previous Image", this);
+    m_previousImageAction->setShortcut(QKeySequence(Qt::Key_PageUp));
+    m_previousImageAction->setStatusTip("Open the previous image in the same folder");
+    m_previousImageAction->setEnabled(false);
+    fileMenu->addAction(m_previousImageAction);
+    
+    fileMenu->addSeparator();
+    
     m_saveAction = new QAction("&Save Wallpaper...", this);
     m_saveAction->setShortcut(QKeySequence::Save);
     m_saveAction->setStatusTip("Save the wallpaper");
     m_saveAction->setEnabled(false);
     fileMenu->addAction(m_saveAction);
     
+    m_exportAllAction = new QAction("Export &All Resolutions...", this);
+    m_exportAllAction->setShortcut(Qt::CTRL | Qt::SHIFT | Qt::Key_S);
+    m_exportAllAction->setStatusTip("Save the crop at several resolutions at once");
+    m_exportAllAction->setEnabled(false);
+    fileMenu->addAction(m_exportAllAction);
+    
     fileMenu->addSeparator();
     
     m_exitAction = new QAction("E&xit", this);
@@ -308,6 +366,17 @@ void MainWindow::setupMenuBar()
     m_toggleCropOverlayAction->setStatusTip("Toggle crop overlay visibility");
     viewMenu->addAction(m_toggleCropOverlayAction);
     
+    viewMenu->addSeparator();
+    
+    m_memoryUsageAction = new QAction("&Memory Usage...", this);
+    m_memoryUsageAction->setStatusTip("Show the memory held by image buffers");
+    viewMenu->addAction(m_memoryUsageAction);
+    
+    m_performanceHudAction = new QAction("&Performance Overlay", this);
+    m_performanceHudAction->setCheckable(true);
+    m_performanceHudAction->setStatusTip("Show decode, adjustment, frame and encode timings in the status bar");
+    viewMenu->addAction(m_performanceHudAction);
+    
     // Settings menu
     QMenu *settingsMenu = menuBar()->addMenu("&Settings");
     
@@ -351,6 +420,14 @@ void MainWindow::setupStatusBar()
     m_progressBar->setVisible(false);
     m_statusBar->addPermanentWidget(m_progressBar);
     
+    m_performanceLabel = new QLabel(this);
+    m_performanceLabel->setVisible(false);
+    m_statusBar->addPermanentWidget(m_performanceLabel);
+    
+    // Polled rather than signalled so the frame rate decays to 0 when idle
+    m_performanceTimer = new QTimer(this);
+    m_performanceTimer->setInterval(500);
+    
     m_statusBar->showMessage("Ready");
 }
 
@@ -359,8 +436,11 @@ void MainWindow::setupConnections()
     // File actions
     connect(m_openAction, &QAction::triggered, this, &MainWindow::openImage);
     connect(m_openButton, &QPushButton::clicked, this, &MainWindow::openImage);
+    connect(m_nextImageAction, &QAction::triggered, this, &MainWindow::openNextImage);
+    connect(m_previousImageAction, &QAction::triggered, this, &MainWindow::openPreviousImage);
     connect(m_saveAction, &QAction::triggered, this, &MainWindow::saveWallpaper);
     connect(m_saveButton, &QPushButton::clicked, this, &MainWindow::saveWallpaper);
+    connect(m_exportAllAction, &QAction::triggered, this, &MainWindow::exportAllResolutions);
     connect(m_exitAction, &QAction::triggered, this, &MainWindow::exit);
     
     // Edit actions
@@ -371,6 +451,9 @@ void MainWindow::setupConnections()
     connect(m_fitToWindowAction, &QAction::triggered, this, &MainWindow::fitToWindow);
     connect(m_actualSizeAction, &QAction::triggered, this, &MainWindow::actualSize);
     connect(m_toggleCropOverlayAction, &QAction::triggered, this, &MainWindow::toggleCropOverlay);
+    connect(m_memoryUsageAction, &QAction::triggered, this, &MainWindow::showMemoryUsage);
+    connect(m_performanceHudAction, &QAction::triggered, this, &MainWindow::togglePerformanceHud);
+    connect(m_performanceTimer, &QTimer::timeout, this, &MainWindow::updatePerformanceHud);
     
     // Settings actions
     connect(m_settingsAction, &QAction::triggered, this, &MainWindow::showSettings);
@@ -393,6 +476,11 @@ void MainWindow::setupConnections()
     connect(m_formatComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &MainWindow::onOutputFormatChanged);
     connect(m_qualitySlider, &QSlider::valueChanged, this, &MainWindow::onQualityChanged);
+    connect(m_maxFileSizeSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &MainWindow::onMaxFileSizeChanged);
+    for (QCheckBox *checkBox : m_additionalFormatCheckBoxes) {
+        connect(checkBox, &QCheckBox::toggled, this, &MainWindow::onAdditionalFormatsChanged);
+    }
     
     // Adjustment sliders
     connect(m_brightnessSlider, &QSlider::valueChanged, this, &MainWindow::onBrightnessChanged);
@@ -404,9 +492,15 @@ void MainWindow::setupConnections()
     connect(m_imageViewer, &ImageViewer::viewChanged, this, &MainWindow::updateStatusBar);
     
     // Image processor connections
+    connect(m_imageProcessor, &ImageProcessor::loadStarted, this, &MainWindow::onLoadStarted);
+    connect(m_imageProcessor, &ImageProcessor::proxyLoaded, this, &MainWindow::onProxyLoaded);
     connect(m_imageProcessor, &ImageProcessor::imageLoaded, this, &MainWindow::onImageLoaded);
+    connect(m_imageProcessor, &ImageProcessor::loadFailed, this, &MainWindow::onLoadFailed);
     connect(m_imageProcessor, &ImageProcessor::imageProcessed, this, &MainWindow::onImageProcessed);
     connect(m_imageProcessor, &ImageProcessor::errorOccurred, this, &MainWindow::onProcessingError);
+    connect(m_imageProcessor, &ImageProcessor::exportProgress, this, &MainWindow::onExportProgress);
+    connect(m_imageProcessor, &ImageProcessor::exportFinished, this, &MainWindow::onExportFinished);
+    connect(m_imageProcessor, &ImageProcessor::exportsIdle, this, &MainWindow::updateProgressBar);
 }
 
 void MainWindow::loadSettings()
@@ -442,6 +536,14 @@ void MainWindow::loadSettings()
     // JPEG quality
     int quality = m_settings->value("JpegQuality", 85).toInt();
     m_qualitySlider->setValue(quality);
+    m_maxFileSizeSpinBox->setValue(m_settings->value("MaxFileSizeKB", 0).toInt());
+    
+    // Formats saved alongside the output format
+    QStringList additionalFormats = m_settings->value("AdditionalExportFormats").toStringList();
+    for (QCheckBox *checkBox : m_additionalFormatCheckBoxes) {
+        auto format = static_cast<ImageProcessor::OutputFormat>(checkBox->property("outputFormat").toInt());
+        checkBox->setChecked(additionalFormats.contains(ImageProcessor::getFormatInfo(format).extension));
+    }
     
     // Remember adjustments if enabled
     bool rememberAdjustments = m_settings->value("RememberAdjustments", true).toBool();
@@ -454,6 +556,23 @@ void MainWindow::loadSettings()
     // Crop overlay visibility
     bool showCropOverlay = m_settings->value("ShowCropOverlay", true).toBool();
     m_toggleCropOverlayAction->setChecked(showCropOverlay);
+    
+    // Performance overlay
+    m_performanceHudAction->setChecked(m_settings->value("ShowPerformanceHud", false).toBool());
+    togglePerformanceHud();
+    
+    // Processing thread cap and memory budget
+    ParallelFor::setMaxThreadCount(m_settings->value("MaxProcessingThreads", 0).toInt());
+    m_imageProcessor->setMemoryBudgetMB(m_settings->value("MemoryBudgetMB",
+                                                          ImageProcessor::DefaultMemoryBudgetMB).toInt());
+    ImageProcessor::setReaderAllocationLimit(m_imageProcessor->memoryBudgetMB());
+    m_imageProcessor->setDecodeCacheMB(m_settings->value("DecodeCacheMB",
+                                                         ImageProcessor::DefaultDecodeCacheMB).toInt());
+    m_imageProcessor->setProxyCacheMB(m_settings->value("ProxyCacheMB",
+                                                        ImageProcessor::DefaultProxyCacheMB).toInt());
+    m_imageProcessor->setPrefetchMemoryMB(m_settings->value("PrefetchMemoryMB",
+                                                            ImageProcessor::DefaultPrefetchMemoryMB).toInt());
+    applyEncoderSpeedSettings();
 }
 
 void MainWindow::saveSettings()
@@ -467,6 +586,12 @@ void MainWindow::saveSettings()
     
     // Current selections
     m_settings->setValue("LastResolution", m_resolutionComboBox->currentIndex());
+    QStringList additionalFormats;
+    for (ImageProcessor::OutputFormat format : m_imageProcessor->getAdditionalFormats()) {
+        additionalFormats << ImageProcessor::getFormatInfo(format).extension;
+    }
+    m_settings->setValue("AdditionalExportFormats", additionalFormats);
+    m_settings->setValue("MaxFileSizeKB", m_maxFileSizeSpinBox->value());
     
     // Remember adjustments if enabled
     bool rememberAdjustments = m_settings->value("RememberAdjustments", true).toBool();
@@ -478,11 +603,20 @@ void MainWindow::saveSettings()
     
     // Crop overlay visibility
     m_settings->setValue("ShowCropOverlay", m_toggleCropOverlayAction->isChecked());
+    m_settings->setValue("ShowPerformanceHud", m_performanceHudAction->isChecked());
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
 {
     saveSettings();
+    
+    // Let queued exports finish writing their files
+    if (m_imageProcessor->pendingExports() > 0) {
+        m_statusBar->showMessage(QString("Finishing %1 exports...").arg(m_imageProcessor->pendingExports()));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        m_imageProcessor->waitForExports();
+        QApplication::restoreOverrideCursor();
+    }
     event->accept();
 }
 
@@ -502,14 +636,23 @@ void MainWindow::openImage()
     QString filePath = QFileDialog::getOpenFileName(this, "Open Image", lastDir, filter);
     if (!filePath.isEmpty()) {
         setLastDirectory(QFileInfo(filePath).absolutePath());
-        if (m_imageProcessor->loadImage(filePath)) {
-            m_currentImagePath = filePath;
-        }
+        m_imageProcessor->loadImage(filePath);
     }
 }
 
+void MainWindow::openNextImage()
+{
+    navigateImage(1);
+}
+
+void MainWindow::openPreviousImage()
+{
+    navigateImage(-1);
+}
+
 void MainWindow::saveWallpaper()
 {
+    TRACE_SCOPE("MainWindow::saveWallpaper");
     if (!m_imageLoaded) {
         return;
     }
@@ -522,17 +665,84 @@ void MainWindow::saveWallpaper()
         return;
     }
     
-    // Apply adjustments and crop/scale
-    QImage processedImage = m_imageProcessor->applyAdjustments(m_imageProcessor->getCurrentImage());
-    QImage finalImage = m_imageProcessor->cropAndScale(processedImage, targetSize, cropRect);
+    // Crop, resample, adjust and encode in the background so the next crop
+    // can be set up straight away
+    m_imageProcessor->queueWallpaper(m_currentImagePath, targetSize, cropRect);
+    m_statusBar->showMessage(QString("Exporting %1x%2...").arg(targetSize.width()).arg(targetSize.height()));
+}
+
+void MainWindow::exportAllResolutions()
+{
+    if (!m_imageLoaded) {
+        return;
+    }
+    
+    QRect cropRect = m_imageViewer->getCropRect();
+    if (cropRect.isEmpty()) {
+        showError("No crop area defined. Please select a resolution first.");
+        return;
+    }
     
-    // Generate suffix
-    QString suffix = QString("_%1x%2").arg(targetSize.width()).arg(targetSize.height());
+    // Let the user pick the resolutions, remembering the last selection
+    QDialog dialog(this);
+    dialog.setWindowTitle("Export All Resolutions");
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(new QLabel("Resolutions with a different aspect ratio use the largest "
+                                 "matching area inside the crop frame.", &dialog));
+    
+    QStringList selected = m_settings->value("ExportResolutions").toStringList();
+    QSize currentSize = m_resolutionComboBox->currentData().toSize();
+    if (selected.isEmpty()) {
+        selected << QString("%1x%2").arg(currentSize.width()).arg(currentSize.height());
+    }
     
-    // Save the image
-    if (m_imageProcessor->saveImage(m_currentImagePath, suffix, finalImage)) {
-        showInfo("Wallpaper saved successfully!");
+    QListWidget *list = new QListWidget(&dialog);
+    for (const auto &resolution : ImageProcessor::getSupportedResolutions()) {
+        QString key = QString("%1x%2").arg(resolution.width).arg(resolution.height);
+        QListWidgetItem *item = new QListWidgetItem(resolution.description, list);
+        item->setData(Qt::UserRole, QSize(resolution.width, resolution.height));
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(selected.contains(key) ? Qt::Checked : Qt::Unchecked);
     }
+    layout->addWidget(list);
+    
+    QCheckBox *verifyCheckBox = new QCheckBox(
+        QString("Check cascaded outputs against direct resampling (%1 dB minimum)")
+            .arg(ImageProcessor::CascadeMinPsnr), &dialog);
+    verifyCheckBox->setChecked(m_settings->value("VerifyCascadeExport", true).toBool());
+    layout->addWidget(verifyCheckBox);
+    
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons);
+    dialog.resize(420, 520);
+    
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    QList<QSize> targetSizes;
+    selected.clear();
+    for (int i = 0; i < list->count(); ++i) {
+        QListWidgetItem *item = list->item(i);
+        QSize size = item->data(Qt::UserRole).toSize();
+        if (item->checkState() == Qt::Checked && !targetSizes.contains(size)) {
+            targetSizes << size;
+            selected << QString("%1x%2").arg(size.width()).arg(size.height());
+        }
+    }
+    bool verify = verifyCheckBox->isChecked();
+    m_settings->setValue("ExportResolutions", selected);
+    m_settings->setValue("VerifyCascadeExport", verify);
+    
+    if (targetSizes.isEmpty()) {
+        return;
+    }
+    
+    // One crop, cascaded resampling, then parallel encodes, all in the background
+    m_imageProcessor->queueWallpapers(m_currentImagePath, targetSizes, cropRect, verify);
+    m_statusBar->showMessage(QString("Exporting %1 wallpapers...").arg(targetSizes.size()));
 }
 
 void MainWindow::exit()
@@ -570,6 +780,89 @@ void MainWindow::toggleCropOverlay()
     m_imageViewer->showCropOverlay(show);
 }
 
+QList<ImageProcessor::BufferUsage> MainWindow::bufferUsage() const
+{
+    QList<ImageProcessor::BufferUsage> usage = m_imageProcessor->memoryUsage();
+    
+    // The viewer shows the processor's image at level 0 and adds the rest
+    const qint64 pyramidBytes = m_imageViewer->pyramidBytes();
+    if (pyramidBytes > 0) {
+        usage.append({"Viewer pyramid levels", QSize(), pyramidBytes, false});
+    }
+    const qint64 tileBytes = m_imageViewer->tileCacheBytes();
+    if (tileBytes > 0) {
+        usage.append({"Viewer tile cache", QSize(), tileBytes, false});
+    }
+    return usage;
+}
+
+void MainWindow::showMemoryUsage()
+{
+    QList<ImageProcessor::BufferUsage> usage = bufferUsage();
+    
+    if (usage.isEmpty()) {
+        QMessageBox::information(this, "Memory Usage", "No image is loaded.");
+        return;
+    }
+    
+    QString report;
+    qint64 total = 0;
+    for (const auto &buffer : usage) {
+        QString line = buffer.name;
+        if (!buffer.size.isEmpty()) {
+            line += QString(" (%1x%2)").arg(buffer.size.width()).arg(buffer.size.height());
+        }
+        line += ": ";
+        line += buffer.shared ? QString("shared with the source") : locale().formattedDataSize(buffer.bytes);
+        report += line + "\n";
+        total += buffer.bytes;
+    }
+    report += QString("\nTotal: %1").arg(locale().formattedDataSize(total));
+    
+    QMessageBox::information(this, "Memory Usage", report);
+}
+
+void MainWindow::togglePerformanceHud()
+{
+    bool show = m_performanceHudAction->isChecked();
+    m_performanceLabel->setVisible(show);
+    if (show) {
+        updatePerformanceHud();
+        m_performanceTimer->start();
+    } else {
+        m_performanceTimer->stop();
+    }
+}
+
+void MainWindow::updatePerformanceHud()
+{
+    auto duration = [](qint64 ms) {
+        return ms < 0 ? QString("-") : QString("%1 ms").arg(ms);
+    };
+    
+    const ImageProcessor::PerformanceStats stats = m_imageProcessor->performanceStats();
+    qint64 bufferBytes = 0;
+    for (const auto &buffer : bufferUsage()) {
+        bufferBytes += buffer.bytes;
+    }
+    
+    const DecodedImageCache::Stats cache = m_imageProcessor->decodeCacheStats();
+    
+    m_performanceLabel->setText(QString("Decode %1 | Cache %2/%3 hits | Adjust %4 | Frame %5 ms, %6 fps | "
+                                        "Buffers %7 | Encode %8")
+                                .arg(duration(stats.decodeMs))
+                                .arg(cache.hits)
+                                .arg(cache.hits + cache.misses)
+                                .arg(duration(stats.adjustMs))
+                                .arg(m_imageViewer->lastFrameMs(), 0, 'f', 1)
+                                .arg(m_imageViewer->framesPerSecond())
+                                .arg(locale().formattedDataSize(bufferBytes))
+                                .arg(duration(stats.encodeMs)));
+    m_performanceLabel->setToolTip(QString("Last save rendered in %1 and encoded in %2")
+                                   .arg(duration(stats.renderMs))
+                                   .arg(duration(stats.encodeMs)));
+}
+
 // Settings
 void MainWindow::showSettings()
 {
@@ -593,8 +886,21 @@ void MainWindow::resetToDefaults()
         resetAdjustments();
         m_resolutionComboBox->setCurrentIndex(2); // Full HD
         m_formatComboBox->setCurrentIndex(0); // PNG
+        for (QCheckBox *checkBox : m_additionalFormatCheckBoxes) {
+            checkBox->setChecked(false);
+        }
         m_qualitySlider->setValue(85);
+        m_maxFileSizeSpinBox->setValue(0);
         m_toggleCropOverlayAction->setChecked(true);
+        m_performanceHudAction->setChecked(false);
+        togglePerformanceHud();
+        ParallelFor::setMaxThreadCount(0);
+        m_imageProcessor->setMemoryBudgetMB(ImageProcessor::DefaultMemoryBudgetMB);
+        ImageProcessor::setReaderAllocationLimit(ImageProcessor::DefaultMemoryBudgetMB);
+        m_imageProcessor->setDecodeCacheMB(ImageProcessor::DefaultDecodeCacheMB);
+        m_imageProcessor->setProxyCacheMB(ImageProcessor::DefaultProxyCacheMB);
+        m_imageProcessor->setPrefetchMemoryMB(ImageProcessor::DefaultPrefetchMemoryMB);
+        applyEncoderSpeedSettings();
         updateUI();
     }
 }
@@ -602,10 +908,9 @@ void MainWindow::resetToDefaults()
 // Image processing slots
 void MainWindow::onImageDropped(const QString &filePath)
 {
+    TRACE_SCOPE("MainWindow::onImageDropped");
     setLastDirectory(QFileInfo(filePath).absolutePath());
-    if (m_imageProcessor->loadImage(filePath)) {
-        m_currentImagePath = filePath;
-    }
+    m_imageProcessor->loadImage(filePath);
 }
 
 void MainWindow::onResolutionChanged()
@@ -625,8 +930,16 @@ void MainWindow::onOutputFormatChanged()
     
     m_imageProcessor->setOutputFormat(format);
     
-    // Show/hide quality controls for JPEG
-    bool isJpeg = (format == ImageProcessor::OutputFormat::JPEG);
+    // The output format is always written, so its extra checkbox is moot
+    for (QCheckBox *checkBox : m_additionalFormatCheckBoxes) {
+        checkBox->setEnabled(checkBox->property("outputFormat").toInt() != formatValue);
+    }
+    
+    // Show/hide quality controls for JPEG and WebP, whichever way they are saved
+    bool isJpeg = false;
+    for (ImageProcessor::OutputFormat outputFormat : m_imageProcessor->outputFormats()) {
+        isJpeg = isJpeg || ImageProcessor::getFormatInfo(outputFormat).supportsQuality;
+    }
     
     // Find quality controls in the format group
     QList<QWidget*> widgets = m_formatGroup->findChildren<QWidget*>();
@@ -651,6 +964,24 @@ void MainWindow::onOutputFormatChanged()
             }
         }
     }
+    
+    // The size cap only applies to formats with a quality setting
+    m_maxFileSizeLabel->setVisible(isJpeg);
+    m_maxFileSizeSpinBox->setVisible(isJpeg);
+}
+
+void MainWindow::onAdditionalFormatsChanged()
+{
+    QList<ImageProcessor::OutputFormat> formats;
+    for (QCheckBox *checkBox : m_additionalFormatCheckBoxes) {
+        if (checkBox->isChecked()) {
+            formats << static_cast<ImageProcessor::OutputFormat>(checkBox->property("outputFormat").toInt());
+        }
+    }
+    m_imageProcessor->setAdditionalFormats(formats);
+    
+    // Quality controls depend on every format being written
+    onOutputFormatChanged();
 }
 
 void MainWindow::onBrightnessChanged()
@@ -681,41 +1012,127 @@ void MainWindow::onQualityChanged()
     m_imageProcessor->setJpegQuality(value);
 }
 
+void MainWindow::onMaxFileSizeChanged()
+{
+    m_imageProcessor->setMaxFileSizeKB(m_maxFileSizeSpinBox->value());
+}
+
 // Image processor signal handlers
-void MainWindow::onImageLoaded(const QString &filePath)
+void MainWindow::onLoadStarted(const QString &filePath)
 {
-    m_imageLoaded = true;
-    m_imageViewer->setImage(m_imageProcessor->getCurrentPixmap());
+    m_requestedImagePath = filePath;
+    
+    // Decoding happens in the background; show a busy indicator meanwhile
+    m_progressBar->setRange(0, 0);
+    m_progressBar->setVisible(true);
+    m_statusBar->showMessage(QString("Loading: %1").arg(QFileInfo(filePath).fileName()));
+}
+
+void MainWindow::onProxyLoaded(const QString &filePath, const QImage &proxy, const QSize &sourceSize)
+{
+    TRACE_SCOPE("MainWindow::onProxyLoaded");
+    // Only something to look at; editing waits for the decoded image
+    m_proxyImagePath = filePath;
+    enableControls(false);
+    m_imageViewer->setImage(proxy, sourceSize);
     
-    // Auto-fit if enabled
     bool autoFit = m_settings->value("AutoFitOnLoad", true).toBool();
     if (autoFit) {
         m_imageViewer->fitToWindow();
     }
+    m_statusBar->showMessage(QString("Loading: %1 (showing cached preview)").arg(QFileInfo(filePath).fileName()));
+}
+
+void MainWindow::onImageLoaded(const QString &filePath)
+{
+    TRACE_SCOPE("MainWindow::onImageLoaded");
+    updateProgressBar();
+    m_currentImagePath = filePath;
+    m_imageLoaded = true;
+    
+    if (m_proxyImagePath == filePath) {
+        // Same scene size as the cached preview, so the view stays put
+        m_imageViewer->updateImage(m_imageProcessor->getCurrentImage(), m_imageProcessor->getImageSize());
+    } else {
+        m_imageViewer->setImage(m_imageProcessor->getCurrentImage(), m_imageProcessor->getImageSize());
+        
+        // Auto-fit if enabled
+        bool autoFit = m_settings->value("AutoFitOnLoad", true).toBool();
+        if (autoFit) {
+            m_imageViewer->fitToWindow();
+        }
+    }
+    m_proxyImagePath.clear();
     
     // Update crop overlay
     onResolutionChanged();
     
     updateUI();
     m_statusBar->showMessage(QString("Loaded: %1").arg(QFileInfo(filePath).fileName()));
+    
+    prefetchNeighbours();
 }
 
 void MainWindow::onImageProcessed()
 {
+    TRACE_SCOPE("MainWindow::onImageProcessed");
     if (m_imageLoaded) {
-        m_imageViewer->setImage(m_imageProcessor->getCurrentPixmap());
-        // Restore crop overlay after image update
-        QSize targetSize = m_resolutionComboBox->currentData().toSize();
-        m_imageViewer->setCropOverlay(targetSize);
-        m_imageViewer->showCropOverlay(m_toggleCropOverlayAction->isChecked());
+        // The preview may be smaller than the source; the viewer keeps the
+        // scene in source pixels so the view and crop frame stay put
+        m_imageViewer->updateImage(m_imageProcessor->getCurrentImage(),
+                                   m_imageProcessor->getImageSize());
     }
 }
 
+void MainWindow::onLoadFailed(const QString &filePath, const QString &error)
+{
+    updateProgressBar();
+    
+    // The previous image is still current; put it back in place of any
+    // cached preview shown while the failed file decoded
+    if (!m_proxyImagePath.isEmpty()) {
+        m_proxyImagePath.clear();
+        if (m_imageLoaded) {
+            m_imageViewer->setImage(m_imageProcessor->getCurrentImage(), m_imageProcessor->getImageSize());
+            
+            bool autoFit = m_settings->value("AutoFitOnLoad", true).toBool();
+            if (autoFit) {
+                m_imageViewer->fitToWindow();
+            }
+            onResolutionChanged();
+        } else {
+            m_imageViewer->clearImage();
+        }
+    }
+    
+    // Controls were disabled while the preview was up
+    updateUI();
+    m_statusBar->showMessage(QString("Could not load: %1").arg(QFileInfo(filePath).fileName()), 5000);
+    showError(error);
+}
+
 void MainWindow::onProcessingError(const QString &error)
 {
+    updateProgressBar();
     showError(error);
 }
 
+void MainWindow::onExportProgress(int percent)
+{
+    // A running load keeps its busy indicator
+    if (m_imageProcessor->isLoading()) {
+        return;
+    }
+    m_progressBar->setRange(0, 100);
+    m_progressBar->setValue(percent);
+    m_progressBar->setVisible(true);
+}
+
+void MainWindow::onExportFinished(const QString &summary)
+{
+    m_statusBar->showMessage(summary, 5000);
+}
+
 // UI updates
 void MainWindow::updateUI()
 {
@@ -738,7 +1155,7 @@ void MainWindow::updateStatusBar()
         return;
     }
     
-    QSize imageSize = m_imageProcessor->getCurrentImage().size();
+    QSize imageSize = m_imageProcessor->getImageSize();
     QSize targetSize = m_resolutionComboBox->currentData().toSize();
     qreal zoomFactor = m_imageViewer->getZoomFactor();
     
@@ -748,10 +1165,27 @@ void MainWindow::updateStatusBar()
                      .arg(targetSize.width())
                      .arg(targetSize.height())
                      .arg(qRound(zoomFactor * 100));
+    if (m_imageProcessor->isStreaming()) {
+        message += " | Streaming from disk";
+    }
     
     m_statusBar->showMessage(message);
 }
 
+void MainWindow::updateProgressBar()
+{
+    // Loading shows a busy indicator; otherwise the bar follows background exports
+    if (m_imageProcessor->isLoading()) {
+        m_progressBar->setRange(0, 0);
+        m_progressBar->setVisible(true);
+    } else if (m_imageProcessor->pendingExports() > 0) {
+        m_progressBar->setRange(0, 100);
+        m_progressBar->setVisible(true);
+    } else {
+        m_progressBar->setVisible(false);
+    }
+}
+
 void MainWindow::updateControlsFromSettings()
 {
     // Update format combo box from settings
@@ -765,6 +1199,28 @@ void MainWindow::updateControlsFromSettings()
     // Update quality slider
     int quality = m_settings->value("JpegQuality", 85).toInt();
     m_qualitySlider->setValue(quality);
+    
+    // Update processing thread cap and memory budget
+    ParallelFor::setMaxThreadCount(m_settings->value("MaxProcessingThreads", 0).toInt());
+    m_imageProcessor->setMemoryBudgetMB(m_settings->value("MemoryBudgetMB",
+                                                          ImageProcessor::DefaultMemoryBudgetMB).toInt());
+    ImageProcessor::setReaderAllocationLimit(m_imageProcessor->memoryBudgetMB());
+    m_imageProcessor->setDecodeCacheMB(m_settings->value("DecodeCacheMB",
+                                                         ImageProcessor::DefaultDecodeCacheMB).toInt());
+    m_imageProcessor->setProxyCacheMB(m_settings->value("ProxyCacheMB",
+                                                        ImageProcessor::DefaultProxyCacheMB).toInt());
+    m_imageProcessor->setPrefetchMemoryMB(m_settings->value("PrefetchMemoryMB",
+                                                            ImageProcessor::DefaultPrefetchMemoryMB).toInt());
+    applyEncoderSpeedSettings();
+}
+
+void MainWindow::applyEncoderSpeedSettings()
+{
+    for (ImageProcessor::OutputFormat format : ImageProcessor::getAvailableOutputFormats()) {
+        int speed = m_settings->value(SettingsDialog::encoderSpeedKey(format),
+                                      static_cast<int>(ImageProcessor::EncoderSpeed::Balanced)).toInt();
+        m_imageProcessor->setEncoderSpeed(format, static_cast<ImageProcessor::EncoderSpeed>(speed));
+    }
 }
 
 void MainWindow::updateImageProcessor()
@@ -810,6 +1266,7 @@ void MainWindow::enableControls(bool enabled)
 {
     m_saveButton->setEnabled(enabled);
     m_saveAction->setEnabled(enabled);
+    m_exportAllAction->setEnabled(enabled);
     m_resolutionGroup->setEnabled(enabled);
     m_formatGroup->setEnabled(enabled);
     m_adjustmentsGroup->setEnabled(enabled);
@@ -818,6 +1275,73 @@ void MainWindow::enableControls(bool enabled)
     m_fitToWindowAction->setEnabled(enabled);
     m_actualSizeAction->setEnabled(enabled);
     m_toggleCropOverlayAction->setEnabled(enabled);
+    m_nextImageAction->setEnabled(enabled);
+    m_previousImageAction->setEnabled(enabled);
+}
+
+QStringList MainWindow::folderImages(const QString &directory) const
+{
+    QStringList nameFilters;
+    for (const QString &extension : ImageProcessor::getSupportedInputExtensions()) {
+        nameFilters << "*." + extension;
+    }
+    QStringList files = QDir(directory).entryList(nameFilters, QDir::Files | QDir::Readable);
+    
+    // Natural order, so img2 comes before img10 as in file managers
+    QCollator collator;
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    std::sort(files.begin(), files.end(), collator);
+    return files;
+}
+
+void MainWindow::navigateImage(int step)
+{
+    // Steps from the image last asked for, so pressing Page Down again
+    // while it decodes moves on rather than requesting it a second time
+    if (m_requestedImagePath.isEmpty()) {
+        return;
+    }
+    
+    QFileInfo current(m_requestedImagePath);
+    const QStringList files = folderImages(current.absolutePath());
+    const int index = files.indexOf(current.fileName());
+    const int target = index + step;
+    if (index < 0 || target < 0 || target >= files.size()) {
+        m_statusBar->showMessage(step > 0 ? "No next image in this folder" : "No previous image in this folder",
+                                 3000);
+        return;
+    }
+    
+    m_imageProcessor->loadImage(current.absoluteDir().filePath(files[target]));
+}
+
+void MainWindow::prefetchNeighbours()
+{
+    const int depth = m_settings->value("PrefetchDepth", ImageProcessor::DefaultPrefetchDepth).toInt();
+    if (depth <= 0 || m_currentImagePath.isEmpty()) {
+        m_imageProcessor->prefetch(QStringList());
+        return;
+    }
+    
+    QFileInfo current(m_currentImagePath);
+    const QStringList files = folderImages(current.absolutePath());
+    const int index = files.indexOf(current.fileName());
+    if (index < 0) {
+        return;
+    }
+    
+    // Nearest first, favouring the forward direction most browsing goes in
+    QStringList neighbours;
+    for (int distance = 1; distance <= depth; ++distance) {
+        if (index + distance < files.size()) {
+            neighbours << current.absoluteDir().filePath(files[index + distance]);
+        }
+        if (index - distance >= 0) {
+            neighbours << current.absoluteDir().filePath(files[index - distance]);
+        }
+    }
+    m_imageProcessor->prefetch(neighbours);
 }
 
 void MainWindow::populateResolutionComboBox(bool vertical)
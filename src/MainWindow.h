@@ -18,6 +18,7 @@
 #include <QLabel>
 #include <QComboBox>
 #include <QCheckBox>
+#include <QSpinBox>
 #include <QSlider>
 #include <QPushButton>
 #include <QGroupBox>
@@ -28,6 +29,7 @@
 #include <QAction>
 #include <QActionGroup>
 #include <QSplitter>
+#include <QTimer>
 #include "ImageViewer.h"
 #include "ImageProcessor.h"
 #include "SettingsDialog.h"
@@ -46,7 +48,10 @@ protected:
 private slots:
     // File operations
     void openImage();
+    void openNextImage();
+    void openPreviousImage();
     void saveWallpaper();
+    void exportAllResolutions();
     void exit();
     
     // Edit operations
@@ -57,6 +62,9 @@ private slots:
     void fitToWindow();
     void actualSize();
     void toggleCropOverlay();
+    void showMemoryUsage();
+    void togglePerformanceHud();
+    void updatePerformanceHud();
     
     // Settings
     void showSettings();
@@ -67,19 +75,27 @@ private slots:
     void onResolutionChanged();
     void onVerticalOrientationChanged();
     void onOutputFormatChanged();
+    void onAdditionalFormatsChanged();
     void onBrightnessChanged();
     void onContrastChanged();
     void onSaturationChanged();
     void onQualityChanged();
+    void onMaxFileSizeChanged();
     
     // Image processor signals
+    void onLoadStarted(const QString &filePath);
+    void onProxyLoaded(const QString &filePath, const QImage &proxy, const QSize &sourceSize);
     void onImageLoaded(const QString &filePath);
+    void onLoadFailed(const QString &filePath, const QString &error);
     void onImageProcessed();
     void onProcessingError(const QString &error);
+    void onExportProgress(int percent);
+    void onExportFinished(const QString &summary);
     
     // UI updates
     void updateUI();
     void updateStatusBar();
+    void updateProgressBar();
 
 private:
     // Central widget and layout
@@ -108,6 +124,9 @@ private:
     QComboBox *m_formatComboBox;
     QSlider *m_qualitySlider;
     QLabel *m_qualityLabel;
+    QSpinBox *m_maxFileSizeSpinBox;
+    QLabel *m_maxFileSizeLabel;
+    QList<QCheckBox*> m_additionalFormatCheckBoxes;
     
     // Adjustment controls
     QSlider *m_brightnessSlider;
@@ -126,16 +145,23 @@ private:
     QToolBar *m_toolBar;
     QStatusBar *m_statusBar;
     QProgressBar *m_progressBar;
+    QLabel *m_performanceLabel;
+    QTimer *m_performanceTimer;
     
     // Actions
     QAction *m_openAction;
+    QAction *m_nextImageAction;
+    QAction *m_previousImageAction;
     QAction *m_saveAction;
+    QAction *m_exportAllAction;
     QAction *m_exitAction;
     QAction *m_resetAdjustmentsAction;
     QAction *m_resetViewAction;
     QAction *m_fitToWindowAction;
     QAction *m_actualSizeAction;
     QAction *m_toggleCropOverlayAction;
+    QAction *m_memoryUsageAction;
+    QAction *m_performanceHudAction;
     QAction *m_settingsAction;
     QAction *m_resetDefaultsAction;
     QAction *m_aboutAction;
@@ -147,6 +173,8 @@ private:
     
     // State
     QString m_currentImagePath;
+    QString m_requestedImagePath; // Most recently asked for, possibly still loading
+    QString m_proxyImagePath;    // Shown from the disk cache while it decodes
     bool m_imageLoaded;
     
     // Setup methods
@@ -164,6 +192,7 @@ private:
     void saveSettings();
     void updateControlsFromSettings();
     void updateImageProcessor();
+    void applyEncoderSpeedSettings();
     void populateResolutionComboBox(bool vertical);
     void showError(const QString &message);
     void showInfo(const QString &message);
@@ -171,6 +200,10 @@ private:
     QString getLastDirectory() const;
     void setLastDirectory(const QString &directory);
     void enableControls(bool enabled);
+    void navigateImage(int step);
+    void prefetchNeighbours();
+    QStringList folderImages(const QString &directory) const; // Naturally sorted
+    QList<ImageProcessor::BufferUsage> bufferUsage() const; // Processor and viewer buffers
 };
 
 #endif // MAINWINDOW_H
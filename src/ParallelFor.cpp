@@ -0,0 +1,119 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "ParallelFor.h"
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <atomic>
+#include <memory>
+
+namespace {
+
+const int kMinRowsPerBand = 16;
+const int kBandsPerThread = 4;
+
+std::atomic<int> s_maxThreadCount(0);
+
+struct Job {
+    ParallelFor::RowRange body;
+    int rows = 0;
+    int bandRows = 0;
+    int bandCount = 0;
+    std::atomic<int> nextBand{0};
+    
+    QMutex mutex;
+    QWaitCondition finished;
+    int completedBands = 0;
+};
+
+void runBands(Job &job)
+{
+    int completed = 0;
+    for (;;) {
+        int band = job.nextBand.fetch_add(1);
+        if (band >= job.bandCount) {
+            break;
+        }
+        int begin = band * job.bandRows;
+        int end = qMin(begin + job.bandRows, job.rows);
+        job.body(begin, end);
+        ++completed;
+    }
+    
+    if (completed > 0) {
+        QMutexLocker locker(&job.mutex);
+        job.completedBands += completed;
+        if (job.completedBands == job.bandCount) {
+            job.finished.wakeAll();
+        }
+    }
+}
+
+} // namespace
+
+void ParallelFor::run(int rows, const RowRange &body)
+{
+    if (rows <= 0) {
+        return;
+    }
+    
+    int threads = threadCount();
+    if (threads <= 1 || rows < 2 * kMinRowsPerBand) {
+        body(0, rows);
+        return;
+    }
+    
+    // Helpers that only get scheduled after the caller finished simply find
+    // no bands left, so the job is shared rather than living on this stack.
+    auto job = std::make_shared<Job>();
+    job->body = body;
+    job->rows = rows;
+    int bands = qMin(threads * kBandsPerThread, (rows + kMinRowsPerBand - 1) / kMinRowsPerBand);
+    job->bandRows = (rows + bands - 1) / bands;
+    job->bandCount = (rows + job->bandRows - 1) / job->bandRows;
+    
+    int helpers = qMin(threads, job->bandCount) - 1;
+    for (int i = 0; i < helpers; ++i) {
+        pool()->start([job]() { runBands(*job); });
+    }
+    
+    runBands(*job);
+    
+    QMutexLocker locker(&job->mutex);
+    while (job->completedBands < job->bandCount) {
+        job->finished.wait(&job->mutex);
+    }
+}
+
+void ParallelFor::setMaxThreadCount(int count)
+{
+    s_maxThreadCount = qMax(0, count);
+}
+
+int ParallelFor::maxThreadCount()
+{
+    return s_maxThreadCount;
+}
+
+int ParallelFor::threadCount()
+{
+    int hardware = qMax(1, QThread::idealThreadCount());
+    int limit = s_maxThreadCount;
+    return limit > 0 ? qMin(limit, hardware) : hardware;
+}
+
+QThreadPool *ParallelFor::pool()
+{
+    // Never destroyed, so late helpers never outlive their pool at exit
+    static QThreadPool *instance = []() {
+        QThreadPool *threadPool = new QThreadPool();
+        threadPool->setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+        return threadPool;
+    }();
+    return instance;
+}
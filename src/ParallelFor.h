@@ -0,0 +1,33 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <QThreadPool>
+#include <functional>
+
+// Splits scanline ranges into bands and runs them on a shared thread pool.
+// The calling thread works on bands too and returns once all are done.
+// Each row is handed to exactly one body call, so per-row kernels produce
+// the same output no matter how many threads take part.
+class ParallelFor
+{
+public:
+    using RowRange = std::function<void(int begin, int end)>;
+    
+    static void run(int rows, const RowRange &body);
+    
+    // Thread cap, 0 means one thread per hardware thread
+    static void setMaxThreadCount(int count);
+    static int maxThreadCount();
+    static int threadCount();
+
+private:
+    static QThreadPool *pool();
+};
+
+#endif // PARALLELFOR_H
@@ -0,0 +1,297 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "PixelKernels.h"
+#include <QByteArray>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PIXELKERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Q20 luma weights for the grayscale estimate (0.299, 0.587, 0.114). The
+// exact weighted sum moves in steps of 0.001 and these stay within 0.0001
+// of it, so adding half a step before the shift truncates like exact math.
+const int kLumaR = 313524;
+const int kLumaG = 615514;
+const int kLumaB = 119538;
+const int kLumaBias = 524;
+
+// Likewise for saturation: the exact product moves in steps of 0.01 and the
+// Q16 factor keeps it within 0.002, so half a step of bias truncates exactly
+const int kSaturationBias = 328;
+
+inline int clampChannel(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+inline int applySaturation(int value, int gray, int factor)
+{
+    return clampChannel(gray + (((value - gray) * factor + kSaturationBias) >> 16));
+}
+
+void adjustRowScalar(const QRgb *in, QRgb *out, int count, const PixelKernels::Params &params)
+{
+    const quint32 *lut = params.toneLut;
+    
+    for (int x = 0; x < count; ++x) {
+        QRgb pixel = in[x];
+        int r = lut[qRed(pixel)];
+        int g = lut[qGreen(pixel)];
+        int b = lut[qBlue(pixel)];
+        
+        if (params.applySaturation) {
+            int gray = (r * kLumaR + g * kLumaG + b * kLumaB + kLumaBias) >> 20;
+            r = applySaturation(r, gray, params.saturationFactor);
+            g = applySaturation(g, gray, params.saturationFactor);
+            b = applySaturation(b, gray, params.saturationFactor);
+        }
+        
+        out[x] = qRgba(r, g, b, qAlpha(pixel));
+    }
+}
+
+#ifdef PIXELKERNELS_X86
+
+// SSE4.1: 4 pixels per vector, two vectors per iteration
+
+// The tone table is read with scalar loads; SSE4.1 has no gather
+__attribute__((target("sse4.1")))
+inline __m128i toneSse41(const QRgb *in, int shift, const quint32 *lut)
+{
+    return _mm_setr_epi32(lut[(in[0] >> shift) & 0xff], lut[(in[1] >> shift) & 0xff],
+                          lut[(in[2] >> shift) & 0xff], lut[(in[3] >> shift) & 0xff]);
+}
+
+__attribute__((target("sse4.1")))
+inline __m128i saturationSse41(__m128i value, __m128i gray, __m128i factor)
+{
+    value = _mm_mullo_epi32(_mm_sub_epi32(value, gray), factor);
+    value = _mm_srai_epi32(_mm_add_epi32(value, _mm_set1_epi32(kSaturationBias)), 16);
+    value = _mm_add_epi32(gray, value);
+    return _mm_min_epi32(_mm_max_epi32(value, _mm_setzero_si128()), _mm_set1_epi32(255));
+}
+
+__attribute__((target("sse4.1")))
+inline __m128i adjustVectorSse41(const QRgb *in, const quint32 *lut, __m128i saturation, bool saturate)
+{
+    __m128i alpha = _mm_andnot_si128(_mm_set1_epi32(0x00ffffff),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+    __m128i r = toneSse41(in, 16, lut);
+    __m128i g = toneSse41(in, 8, lut);
+    __m128i b = toneSse41(in, 0, lut);
+    
+    if (saturate) {
+        __m128i gray = _mm_add_epi32(_mm_mullo_epi32(r, _mm_set1_epi32(kLumaR)),
+                                     _mm_mullo_epi32(g, _mm_set1_epi32(kLumaG)));
+        gray = _mm_add_epi32(gray, _mm_mullo_epi32(b, _mm_set1_epi32(kLumaB)));
+        gray = _mm_srli_epi32(_mm_add_epi32(gray, _mm_set1_epi32(kLumaBias)), 20);
+        r = saturationSse41(r, gray, saturation);
+        g = saturationSse41(g, gray, saturation);
+        b = saturationSse41(b, gray, saturation);
+    }
+    
+    __m128i result = _mm_or_si128(alpha, _mm_slli_epi32(r, 16));
+    result = _mm_or_si128(result, _mm_slli_epi32(g, 8));
+    return _mm_or_si128(result, b);
+}
+
+__attribute__((target("sse4.1")))
+void adjustRowSse41(const QRgb *in, QRgb *out, int count, const PixelKernels::Params &params)
+{
+    const __m128i saturation = _mm_set1_epi32(params.saturationFactor);
+    const bool saturate = params.applySaturation;
+    
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m128i p0 = adjustVectorSse41(in + x, params.toneLut, saturation, saturate);
+        __m128i p1 = adjustVectorSse41(in + x + 4, params.toneLut, saturation, saturate);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), p0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x + 4), p1);
+    }
+    
+    adjustRowScalar(in + x, out + x, count - x, params);
+}
+
+// AVX2: 8 pixels per vector, two vectors per iteration
+
+__attribute__((target("avx2")))
+inline __m256i toneAvx2(__m256i pixels, int shift, const quint32 *lut)
+{
+    const __m256i index = _mm256_and_si256(_mm256_srli_epi32(pixels, shift), _mm256_set1_epi32(0xff));
+    return _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), index, 4);
+}
+
+__attribute__((target("avx2")))
+inline __m256i saturationAvx2(__m256i value, __m256i gray, __m256i factor)
+{
+    value = _mm256_mullo_epi32(_mm256_sub_epi32(value, gray), factor);
+    value = _mm256_srai_epi32(_mm256_add_epi32(value, _mm256_set1_epi32(kSaturationBias)), 16);
+    value = _mm256_add_epi32(gray, value);
+    return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_setzero_si256()), _mm256_set1_epi32(255));
+}
+
+__attribute__((target("avx2")))
+inline __m256i adjustVectorAvx2(__m256i pixels, const quint32 *lut, __m256i saturation, bool saturate)
+{
+    __m256i alpha = _mm256_andnot_si256(_mm256_set1_epi32(0x00ffffff), pixels);
+    __m256i r = toneAvx2(pixels, 16, lut);
+    __m256i g = toneAvx2(pixels, 8, lut);
+    __m256i b = toneAvx2(pixels, 0, lut);
+    
+    if (saturate) {
+        __m256i gray = _mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(kLumaR)),
+                                        _mm256_mullo_epi32(g, _mm256_set1_epi32(kLumaG)));
+        gray = _mm256_add_epi32(gray, _mm256_mullo_epi32(b, _mm256_set1_epi32(kLumaB)));
+        gray = _mm256_srli_epi32(_mm256_add_epi32(gray, _mm256_set1_epi32(kLumaBias)), 20);
+        r = saturationAvx2(r, gray, saturation);
+        g = saturationAvx2(g, gray, saturation);
+        b = saturationAvx2(b, gray, saturation);
+    }
+    
+    __m256i result = _mm256_or_si256(alpha, _mm256_slli_epi32(r, 16));
+    result = _mm256_or_si256(result, _mm256_slli_epi32(g, 8));
+    return _mm256_or_si256(result, b);
+}
+
+__attribute__((target("avx2")))
+void adjustRowAvx2(const QRgb *in, QRgb *out, int count, const PixelKernels::Params &params)
+{
+    const __m256i saturation = _mm256_set1_epi32(params.saturationFactor);
+    const bool saturate = params.applySaturation;
+    
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x));
+        __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x + 8));
+        p0 = adjustVectorAvx2(p0, params.toneLut, saturation, saturate);
+        p1 = adjustVectorAvx2(p1, params.toneLut, saturation, saturate);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), p0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x + 8), p1);
+    }
+    
+    for (; x + 8 <= count; x += 8) {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x));
+        p = adjustVectorAvx2(p, params.toneLut, saturation, saturate);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), p);
+    }
+    
+    adjustRowScalar(in + x, out + x, count - x, params);
+}
+
+#endif // PIXELKERNELS_X86
+
+} // namespace
+
+PixelKernels::Params PixelKernels::makeParams(int brightness, int contrast, int saturation)
+{
+    brightness = qBound(-100, brightness, 100);
+    contrast = qBound(-100, contrast, 100);
+    saturation = qBound(-100, saturation, 100);
+    
+    Params params;
+    params.saturationFactor = static_cast<int>(std::lround((saturation + 100.0) / 100.0 * 65536.0));
+    params.applySaturation = (saturation != 0);
+    
+    // Brightness then contrast depend only on the channel value, so the
+    // table holds exactly what the separate double-precision passes gave
+    const int adjustment = brightness * 255 / 100;
+    const double contrastFactor = (259.0 * (contrast + 255.0)) / (255.0 * (259.0 - contrast));
+    for (int value = 0; value < 256; ++value) {
+        int result = qBound(0, value + adjustment, 255);
+        if (contrast != 0) {
+            result = qBound(0, static_cast<int>(contrastFactor * (result - 128) + 128), 255);
+        }
+        params.toneLut[value] = static_cast<quint32>(result);
+    }
+    
+    return params;
+}
+
+void PixelKernels::adjustRow(const QRgb *in, QRgb *out, int count, const Params &params)
+{
+    static const RowFunction function = rowFunction(activeIsa());
+    function(in, out, count, params);
+}
+
+PixelKernels::Isa PixelKernels::activeIsa()
+{
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+PixelKernels::Isa PixelKernels::detectIsa()
+{
+    // WALLPAPERMAKER_SIMD=scalar|sse4.1|avx2 pins a kernel for debugging
+    QByteArray forced = qgetenv("WALLPAPERMAKER_SIMD").toLower();
+    if (forced == "scalar") {
+        return Isa::Scalar;
+    } else if (forced == "sse4.1" && isSupported(Isa::SSE41)) {
+        return Isa::SSE41;
+    } else if (forced == "avx2" && isSupported(Isa::AVX2)) {
+        return Isa::AVX2;
+    }
+    
+    if (isSupported(Isa::AVX2)) {
+        return Isa::AVX2;
+    }
+    if (isSupported(Isa::SSE41)) {
+        return Isa::SSE41;
+    }
+    return Isa::Scalar;
+}
+
+bool PixelKernels::isSupported(Isa isa)
+{
+#ifdef PIXELKERNELS_X86
+    __builtin_cpu_init();
+    switch (isa) {
+    case Isa::Scalar:
+        return true;
+    case Isa::SSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case Isa::AVX2:
+        return __builtin_cpu_supports("avx2");
+    }
+    return false;
+#else
+    return isa == Isa::Scalar;
+#endif
+}
+
+PixelKernels::RowFunction PixelKernels::rowFunction(Isa isa)
+{
+    if (!isSupported(isa)) {
+        return nullptr;
+    }
+    
+    switch (isa) {
+#ifdef PIXELKERNELS_X86
+    case Isa::SSE41:
+        return adjustRowSse41;
+    case Isa::AVX2:
+        return adjustRowAvx2;
+#endif
+    default:
+        return adjustRowScalar;
+    }
+}
+
+QString PixelKernels::isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::SSE41:
+        return "SSE4.1";
+    case Isa::AVX2:
+        return "AVX2";
+    default:
+        return "Scalar";
+    }
+}
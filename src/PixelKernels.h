@@ -0,0 +1,52 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef PIXELKERNELS_H
+#define PIXELKERNELS_H
+
+#include <QtGlobal>
+#include <QColor>
+#include <QString>
+
+// Row kernels for the brightness/contrast/saturation pass. Brightness and
+// contrast come from a table built with the original double-precision
+// formulas; saturation uses fixed-point math biased so that it truncates
+// like exact arithmetic. Every variant gives identical output, within 1 per
+// channel of the separate double-precision passes.
+class PixelKernels
+{
+public:
+    enum class Isa {
+        Scalar,
+        SSE41,
+        AVX2
+    };
+    
+    struct Params {
+        int saturationFactor;  // Q16 fixed point, 65536 = unchanged
+        bool applySaturation;
+        quint32 toneLut[256];  // Brightness then contrast; 32-bit for gathers
+    };
+    
+    using RowFunction = void (*)(const QRgb *in, QRgb *out, int count, const Params &params);
+    
+    // Parameters for slider values in the -100 to 100 range
+    static Params makeParams(int brightness, int contrast, int saturation);
+    
+    // Adjusts one row of ARGB32 pixels with the best kernel for this CPU
+    static void adjustRow(const QRgb *in, QRgb *out, int count, const Params &params);
+    
+    // Kernel selection
+    static Isa activeIsa();
+    static bool isSupported(Isa isa);
+    static RowFunction rowFunction(Isa isa);
+    static QString isaName(Isa isa);
+
+private:
+    static Isa detectIsa();
+};
+
+#endif // PIXELKERNELS_H
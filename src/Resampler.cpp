@@ -0,0 +1,488 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "Resampler.h"
+#include "PixelKernels.h"
+#include "ParallelFor.h"
+#include "Trace.h"
+#include <QColor>
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define RESAMPLER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const int kWeightBits = 14;
+const int kWeightOne = 1 << kWeightBits;
+const int kRounding = 1 << (kWeightBits - 1);
+
+inline int clampChannel(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+inline QRgb packChannels(int b, int g, int r, int a)
+{
+    return qRgba(clampChannel(r >> kWeightBits), clampChannel(g >> kWeightBits),
+                 clampChannel(b >> kWeightBits), clampChannel(a >> kWeightBits));
+}
+
+using HorizontalFunction = void (*)(const QRgb *in, QRgb *out, int width,
+                                    const int *first, const int *count, const qint16 *weights, int stride);
+using VerticalFunction = void (*)(const uchar *rows, qsizetype rowStride, int count,
+                                  const qint16 *weights, QRgb *out, int width);
+
+void horizontalScalar(const QRgb *in, QRgb *out, int width,
+                      const int *first, const int *count, const qint16 *weights, int stride)
+{
+    for (int x = 0; x < width; ++x) {
+        const QRgb *pixels = in + first[x];
+        const qint16 *w = weights + static_cast<qsizetype>(x) * stride;
+        int b = kRounding, g = kRounding, r = kRounding, a = kRounding;
+        for (int k = 0; k < count[x]; ++k) {
+            b += qBlue(pixels[k]) * w[k];
+            g += qGreen(pixels[k]) * w[k];
+            r += qRed(pixels[k]) * w[k];
+            a += qAlpha(pixels[k]) * w[k];
+        }
+        out[x] = packChannels(b, g, r, a);
+    }
+}
+
+void verticalScalarRange(const uchar *rows, qsizetype rowStride, int count,
+                         const qint16 *weights, QRgb *out, int begin, int end)
+{
+    for (int x = begin; x < end; ++x) {
+        int b = kRounding, g = kRounding, r = kRounding, a = kRounding;
+        for (int k = 0; k < count; ++k) {
+            QRgb pixel = reinterpret_cast<const QRgb*>(rows + k * rowStride)[x];
+            b += qBlue(pixel) * weights[k];
+            g += qGreen(pixel) * weights[k];
+            r += qRed(pixel) * weights[k];
+            a += qAlpha(pixel) * weights[k];
+        }
+        out[x] = packChannels(b, g, r, a);
+    }
+}
+
+void verticalScalar(const uchar *rows, qsizetype rowStride, int count,
+                    const qint16 *weights, QRgb *out, int width)
+{
+    verticalScalarRange(rows, rowStride, count, weights, out, 0, width);
+}
+
+#ifdef RESAMPLER_X86
+
+// SSE4.1: taps are taken in pairs so each _mm_madd_epi16 applies two
+// weights to all four channels. Same fixed-point math as the scalar path.
+
+__attribute__((target("sse4.1")))
+inline __m128i pairWeights(const qint16 *w)
+{
+    return _mm_set1_epi32(static_cast<int>((static_cast<quint32>(static_cast<quint16>(w[1])) << 16) | static_cast<quint16>(w[0])));
+}
+
+__attribute__((target("sse4.1")))
+inline quint32 packSse41(__m128i sum)
+{
+    sum = _mm_srai_epi32(sum, kWeightBits);
+    sum = _mm_packs_epi32(sum, sum);
+    return static_cast<quint32>(_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum)));
+}
+
+__attribute__((target("sse4.1")))
+inline __m128i loadPixels(const uchar *row, int x)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(reinterpret_cast<const QRgb*>(row) + x));
+}
+
+__attribute__((target("sse4.1")))
+void horizontalSse41(const QRgb *in, QRgb *out, int width,
+                     const int *first, const int *count, const qint16 *weights, int stride)
+{
+    // Spread two pixels into 16-bit lanes as (p0.b, p1.b, p0.g, p1.g, ...)
+    const __m128i interleave = _mm_setr_epi8(0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1);
+    
+    for (int x = 0; x < width; ++x) {
+        const QRgb *pixels = in + first[x];
+        const qint16 *w = weights + static_cast<qsizetype>(x) * stride;
+        const int taps = count[x];
+        __m128i sum = _mm_set1_epi32(kRounding);
+        
+        int k = 0;
+        for (; k + 1 < taps; k += 2) {
+            __m128i pair = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + k));
+            pair = _mm_shuffle_epi8(pair, interleave);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, pairWeights(w + k)));
+        }
+        if (k < taps) {
+            __m128i pixel = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(pixels[k])));
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(pixel, _mm_set1_epi32(w[k])));
+        }
+        
+        out[x] = packSse41(sum);
+    }
+}
+
+__attribute__((target("sse4.1")))
+void verticalSse41(const uchar *rows, qsizetype rowStride, int count,
+                   const qint16 *weights, QRgb *out, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i s0 = _mm_set1_epi32(kRounding);
+        __m128i s1 = s0, s2 = s0, s3 = s0;
+        
+        int k = 0;
+        for (; k + 1 < count; k += 2) {
+            __m128i r0 = loadPixels(rows + k * rowStride, x);
+            __m128i r1 = loadPixels(rows + (k + 1) * rowStride, x);
+            __m128i w = pairWeights(weights + k);
+            
+            // Byte-interleave the two rows, then widen: each pixel becomes
+            // four (row0, row1) pairs ready for madd
+            __m128i lo = _mm_unpacklo_epi8(r0, r1);
+            __m128i hi = _mm_unpackhi_epi8(r0, r1);
+            s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w));
+            s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w));
+            s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w));
+            s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w));
+        }
+        if (k < count) {
+            __m128i r0 = loadPixels(rows + k * rowStride, x);
+            __m128i w = _mm_set1_epi32(weights[k]);
+            s0 = _mm_add_epi32(s0, _mm_mullo_epi32(_mm_cvtepu8_epi32(r0), w));
+            s1 = _mm_add_epi32(s1, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(r0, 4)), w));
+            s2 = _mm_add_epi32(s2, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(r0, 8)), w));
+            s3 = _mm_add_epi32(s3, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(r0, 12)), w));
+        }
+        
+        __m128i lower = _mm_packs_epi32(_mm_srai_epi32(s0, kWeightBits), _mm_srai_epi32(s1, kWeightBits));
+        __m128i upper = _mm_packs_epi32(_mm_srai_epi32(s2, kWeightBits), _mm_srai_epi32(s3, kWeightBits));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(lower, upper));
+    }
+    
+    verticalScalarRange(rows, rowStride, count, weights, out, x, width);
+}
+
+#endif // RESAMPLER_X86
+
+HorizontalFunction horizontalFunction()
+{
+#ifdef RESAMPLER_X86
+    if (PixelKernels::activeIsa() != PixelKernels::Isa::Scalar) {
+        return horizontalSse41;
+    }
+#endif
+    return horizontalScalar;
+}
+
+VerticalFunction verticalFunction()
+{
+#ifdef RESAMPLER_X86
+    if (PixelKernels::activeIsa() != PixelKernels::Isa::Scalar) {
+        return verticalSse41;
+    }
+#endif
+    return verticalScalar;
+}
+
+} // namespace
+
+Resampler::Resampler(const QRectF &sourceRect, const QSize &targetSize, Filter filter)
+    : m_sourceRect(sourceRect)
+    , m_targetSize(targetSize)
+    , m_filter(filter)
+{
+    // Checked here so computeAxis never divides by an empty target, and
+    // the float to int conversions below never see inf, NaN or overflow
+    const double limit = 1 << 30;
+    auto inRange = [limit](double value) { return value > -limit && value < limit; };
+    if (targetSize.isEmpty() || !(sourceRect.width() > 0) || !(sourceRect.height() > 0)
+        || !inRange(sourceRect.left()) || !inRange(sourceRect.top())
+        || !inRange(sourceRect.right()) || !inRange(sourceRect.bottom())) {
+        m_targetSize = QSize();
+        return;
+    }
+    
+    int left = static_cast<int>(std::floor(sourceRect.left()));
+    int top = static_cast<int>(std::floor(sourceRect.top()));
+    int right = qMax(left + 1, static_cast<int>(std::ceil(sourceRect.right())));
+    int bottom = qMax(top + 1, static_cast<int>(std::ceil(sourceRect.bottom())));
+    m_bounds = QRect(QPoint(left, top), QPoint(right - 1, bottom - 1));
+    
+    m_horizontal = computeAxis(sourceRect.left(), sourceRect.width(), targetSize.width(), left, right, filter);
+    m_vertical = computeAxis(sourceRect.top(), sourceRect.height(), targetSize.height(), top, bottom, filter);
+}
+
+QString Resampler::filterName(Filter filter)
+{
+    switch (filter) {
+    case Filter::Box:
+        return "Box";
+    case Filter::Mitchell:
+        return "Mitchell";
+    case Filter::Lanczos3:
+        return "Lanczos3";
+    }
+    return QString();
+}
+
+double Resampler::filterSupport(Filter filter)
+{
+    switch (filter) {
+    case Filter::Box:
+        return 0.5;
+    case Filter::Mitchell:
+        return 2.0;
+    case Filter::Lanczos3:
+        return 3.0;
+    }
+    return 1.0;
+}
+
+double Resampler::filterValue(Filter filter, double x)
+{
+    x = std::fabs(x);
+    switch (filter) {
+    case Filter::Box:
+        return x <= 0.5 ? 1.0 : 0.0;
+    case Filter::Mitchell: {
+        // B = C = 1/3
+        const double b = 1.0 / 3.0;
+        const double c = 1.0 / 3.0;
+        if (x < 1.0) {
+            return ((12 - 9 * b - 6 * c) * x * x * x + (-18 + 12 * b + 6 * c) * x * x + (6 - 2 * b)) / 6.0;
+        }
+        if (x < 2.0) {
+            return ((-b - 6 * c) * x * x * x + (6 * b + 30 * c) * x * x
+                    + (-12 * b - 48 * c) * x + (8 * b + 24 * c)) / 6.0;
+        }
+        return 0.0;
+    }
+    case Filter::Lanczos3: {
+        if (x < 1e-8) {
+            return 1.0;
+        }
+        if (x >= 3.0) {
+            return 0.0;
+        }
+        const double pi = 3.14159265358979323846;
+        return 3.0 * std::sin(pi * x) * std::sin(pi * x / 3.0) / (pi * pi * x * x);
+    }
+    }
+    return 0.0;
+}
+
+Resampler::Axis Resampler::computeAxis(double start, double length, int targetLength,
+                                       int lowest, int highest, Filter filter)
+{
+    // When shrinking, stretch the filter over the source so every source
+    // pixel contributes; when enlarging, sample it at unit scale
+    const double scale = length / targetLength;
+    const double filterScale = qMax(scale, 1.0);
+    const double support = filterSupport(filter) * filterScale;
+    
+    Axis axis;
+    axis.stride = static_cast<int>(std::ceil(support)) * 2 + 1;
+    axis.first.resize(targetLength);
+    axis.count.resize(targetLength);
+    axis.weights.assign(static_cast<size_t>(targetLength) * axis.stride, 0);
+    
+    std::vector<double> taps(axis.stride);
+    for (int i = 0; i < targetLength; ++i) {
+        const double center = start + (i + 0.5) * scale;
+        int begin = qMax(lowest, static_cast<int>(std::floor(center - support + 0.5)));
+        int end = qMin(highest, static_cast<int>(std::floor(center + support + 0.5)));
+        end = qMin(end, begin + axis.stride);
+        
+        double total = 0.0;
+        for (int x = begin; x < end; ++x) {
+            taps[x - begin] = filterValue(filter, (x - center + 0.5) / filterScale);
+            total += taps[x - begin];
+        }
+        
+        // Degenerate window (e.g. a box narrower than a pixel): nearest pixel
+        if (end <= begin || total == 0.0) {
+            begin = qBound(lowest, static_cast<int>(std::floor(center)), highest - 1);
+            end = begin + 1;
+            taps[0] = 1.0;
+            total = 1.0;
+        }
+        
+        // Quantize, then put the rounding residue on the largest tap so the
+        // weights sum to exactly one and flat areas stay flat
+        qint16 *weights = axis.weights.data() + static_cast<size_t>(i) * axis.stride;
+        int sum = 0;
+        int largest = 0;
+        for (int k = 0; k < end - begin; ++k) {
+            weights[k] = static_cast<qint16>(std::lround(taps[k] / total * kWeightOne));
+            sum += weights[k];
+            if (weights[k] > weights[largest]) {
+                largest = k;
+            }
+        }
+        weights[largest] = static_cast<qint16>(weights[largest] + kWeightOne - sum);
+        
+        axis.first[i] = begin - lowest;
+        axis.count[i] = end - begin;
+    }
+    
+    return axis;
+}
+
+QImage Resampler::resample(const QImage &image, const QRectF &sourceRect, const QSize &targetSize, Filter filter)
+{
+    return Resampler(sourceRect, targetSize, filter).resample(image);
+}
+
+QImage Resampler::resample(const QImage &image) const
+{
+    TRACE_SCOPE("Resampler::resample");
+    if (image.isNull() || !isValid()) {
+        return QImage();
+    }
+    
+    QImage result = createTarget(image);
+    if (!result.isNull()) {
+        resampleRows(image, 0, &result, 0, m_targetSize.height());
+    }
+    return result;
+}
+
+QImage Resampler::createTarget(const QImage &source) const
+{
+    // Filtering premultiplied pixels keeps transparent areas from bleeding
+    // their color into opaque ones
+    QImage result(m_targetSize, source.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                         : QImage::Format_RGB32);
+    if (!result.isNull()) {
+        result.setDotsPerMeterX(source.dotsPerMeterX());
+        result.setDotsPerMeterY(source.dotsPerMeterY());
+        result.setColorSpace(source.colorSpace());
+    }
+    return result;
+}
+
+void Resampler::sourceRows(int targetBegin, int targetEnd, int *first, int *last) const
+{
+    if (!isValid() || targetBegin >= targetEnd) {
+        *first = 0;
+        *last = 0;
+        return;
+    }
+    *first = m_bounds.top() + m_vertical.first[targetBegin];
+    *last = m_bounds.top() + m_vertical.first[targetEnd - 1] + m_vertical.count[targetEnd - 1];
+}
+
+void Resampler::resampleRows(const QImage &image, int imageTop, QImage *target, int targetBegin, int targetEnd) const
+{
+    if (!isValid() || targetBegin >= targetEnd) {
+        return;
+    }
+    
+    // Rows of the source bounds that these output rows read
+    const int firstRow = m_vertical.first[targetBegin];
+    const int lastRow = m_vertical.first[targetEnd - 1] + m_vertical.count[targetEnd - 1];
+    
+    // 32-bit formats are read in place; anything else converts just the
+    // part of the image the filter touches
+    QImage source = image;
+    QPoint origin(m_bounds.left(), m_bounds.top() - imageTop);
+    const QImage::Format format = image.format();
+    if (format != QImage::Format_RGB32 && format != QImage::Format_ARGB32
+        && format != QImage::Format_ARGB32_Premultiplied) {
+        QRect area = QRect(origin.x(), origin.y() + firstRow, m_bounds.width(), lastRow - firstRow)
+                     .intersected(image.rect());
+        if (area.isEmpty()) {
+            area = QRect(0, 0, 1, 1);
+        }
+        source = image.copy(area).convertToFormat(image.hasAlphaChannel()
+                                                  ? QImage::Format_ARGB32_Premultiplied
+                                                  : QImage::Format_RGB32);
+        origin -= area.topLeft();
+    }
+    
+    const bool opaque = (target->format() == QImage::Format_RGB32);
+    const bool premultiply = (source.format() == QImage::Format_ARGB32);
+    const QRgb outside = opaque ? 0xff000000 : 0x00000000;
+    
+    const int targetWidth = m_targetSize.width();
+    const int boundsWidth = m_bounds.width();
+    
+    // Only the rows some output row reads go through the horizontal pass
+    QImage intermediate(targetWidth, lastRow - firstRow, target->format());
+    if (intermediate.isNull()) {
+        return;
+    }
+    
+    const uchar *sourceBits = source.constBits();
+    const qsizetype sourceStride = source.bytesPerLine();
+    const int sourceWidth = source.width();
+    const int sourceHeight = source.height();
+    uchar *intermediateBits = intermediate.bits();
+    const qsizetype intermediateStride = intermediate.bytesPerLine();
+    uchar *resultBits = target->bits();
+    const qsizetype resultStride = target->bytesPerLine();
+    
+    const HorizontalFunction horizontal = horizontalFunction();
+    const VerticalFunction vertical = verticalFunction();
+    
+    ParallelFor::run(intermediate.height(), [&](int begin, int end) {
+        std::vector<QRgb> buffer(boundsWidth);
+        for (int y = begin; y < end; ++y) {
+            const int sy = origin.y() + firstRow + y;
+            const QRgb *row = buffer.data();
+            
+            if (sy < 0 || sy >= sourceHeight) {
+                std::fill(buffer.begin(), buffer.end(), outside);
+            } else {
+                const QRgb *line = reinterpret_cast<const QRgb*>(sourceBits + sy * sourceStride);
+                const int sx = origin.x();
+                if (!premultiply && sx >= 0 && sx + boundsWidth <= sourceWidth) {
+                    row = line + sx;
+                } else {
+                    // Edges of the image, or straight alpha that needs premultiplying
+                    for (int x = 0; x < boundsWidth; ++x) {
+                        const int px = sx + x;
+                        if (px < 0 || px >= sourceWidth) {
+                            buffer[x] = outside;
+                        } else {
+                            buffer[x] = premultiply ? qPremultiply(line[px]) : line[px];
+                        }
+                    }
+                }
+            }
+            
+            horizontal(row, reinterpret_cast<QRgb*>(intermediateBits + y * intermediateStride), targetWidth,
+                       m_horizontal.first.data(), m_horizontal.count.data(),
+                       m_horizontal.weights.data(), m_horizontal.stride);
+        }
+    });
+    
+    ParallelFor::run(targetEnd - targetBegin, [&](int begin, int end) {
+        for (int y = targetBegin + begin; y < targetBegin + end; ++y) {
+            const uchar *rows = intermediateBits + (m_vertical.first[y] - firstRow) * intermediateStride;
+            QRgb *out = reinterpret_cast<QRgb*>(resultBits + y * resultStride);
+            vertical(rows, intermediateStride, m_vertical.count[y],
+                     m_vertical.weights.data() + static_cast<size_t>(y) * m_vertical.stride, out, targetWidth);
+            
+            // Negative lobes can push a color past its alpha
+            if (!opaque) {
+                for (int x = 0; x < targetWidth; ++x) {
+                    int a = qAlpha(out[x]);
+                    out[x] = qRgba(qMin(qRed(out[x]), a), qMin(qGreen(out[x]), a), qMin(qBlue(out[x]), a), a);
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,77 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QImage>
+#include <QRectF>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <vector>
+
+// Separable two-pass resampler. Filter taps for both axes are computed once
+// in Q14 fixed point; the horizontal pass covers only the source rows the
+// vertical pass needs, and both passes are split across threads. The source
+// rect is read in place, so cropping costs no copy. Pixels of the rect that
+// fall outside the image read as transparent (or black for opaque images),
+// the same as QImage::copy. An empty target size or a source rect that is
+// empty, not finite or beyond int coordinates makes the resampler invalid;
+// it then computes no taps and produces null images.
+class Resampler
+{
+public:
+    enum class Filter {
+        Box,
+        Mitchell,
+        Lanczos3
+    };
+    
+    Resampler(const QRectF &sourceRect, const QSize &targetSize, Filter filter = Filter::Lanczos3);
+    
+    QImage resample(const QImage &image) const;
+    static QImage resample(const QImage &image, const QRectF &sourceRect, const QSize &targetSize,
+                           Filter filter = Filter::Lanczos3);
+    
+    // Banded use, for sources too large to hold at once. sourceRows gives
+    // the image rows [first, last) that output rows [targetBegin, targetEnd)
+    // read; resampleRows renders those output rows into target (made by
+    // createTarget) from a strip of the image whose first row is imageTop.
+    // The strip must hold every row of that range that lies in the image.
+    // Output is identical to resampling the whole image at once.
+    void sourceRows(int targetBegin, int targetEnd, int *first, int *last) const;
+    QImage createTarget(const QImage &source) const;
+    void resampleRows(const QImage &image, int imageTop, QImage *target, int targetBegin, int targetEnd) const;
+    
+    bool isValid() const { return !m_targetSize.isEmpty(); }
+    QSize targetSize() const { return m_targetSize; }
+    Filter filter() const { return m_filter; }
+    static QString filterName(Filter filter);
+
+private:
+    // Taps for one axis: output i reads count[i] source pixels starting at
+    // first[i], relative to the start of the source bounds
+    struct Axis {
+        std::vector<int> first;
+        std::vector<int> count;
+        std::vector<qint16> weights; // Q14, stride entries per output
+        int stride;
+    };
+    
+    QRectF m_sourceRect;
+    QRect m_bounds;       // Whole source pixels touched by the filter
+    QSize m_targetSize;
+    Filter m_filter;
+    Axis m_horizontal;
+    Axis m_vertical;
+    
+    static Axis computeAxis(double start, double length, int targetLength, int lowest, int highest, Filter filter);
+    static double filterSupport(Filter filter);
+    static double filterValue(Filter filter, double x);
+};
+
+#endif // RESAMPLER_H
@@ -0,0 +1,552 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "ScanlineReader.h"
+#include "Trace.h"
+#include <QFile>
+#include <QImageReader>
+#include <QImageIOHandler>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// The C decoders report errors by longjmp, so the functions that call
+// them keep only trivially destructible locals
+#if defined(WALLPAPERMAKER_HAVE_LIBJPEG) || defined(WALLPAPERMAKER_HAVE_LIBPNG)
+#include <csetjmp>
+#endif
+#ifdef WALLPAPERMAKER_HAVE_LIBJPEG
+#include <jpeglib.h>
+#endif
+#ifdef WALLPAPERMAKER_HAVE_LIBPNG
+#include <png.h>
+#endif
+#ifdef WALLPAPERMAKER_HAVE_LIBTIFF
+#include <tiffio.h>
+#endif
+
+// Decodes rows in order into a caller's image, whose format is format()
+class ScanlineReader::Backend
+{
+public:
+    virtual ~Backend() = default;
+    
+    QSize size() const { return m_size; }
+    QImage::Format format() const { return m_format; }
+    QString errorString() const { return m_error; }
+    
+    // The next count rows, into rows [row, row + count) of image
+    virtual bool read(QImage *image, int row, int count) = 0;
+    
+    virtual bool skip(int count)
+    {
+        QImage scratch(m_size.width(), qMin(count, 64), m_format);
+        if (scratch.isNull()) {
+            m_error = "Not enough memory to skip image rows";
+            return false;
+        }
+        while (count > 0) {
+            const int rows = qMin(count, scratch.height());
+            if (!read(&scratch, 0, rows)) {
+                return false;
+            }
+            count -= rows;
+        }
+        return true;
+    }
+
+protected:
+    QSize m_size;
+    QImage::Format m_format = QImage::Format_RGB32;
+    QString m_error;
+};
+
+namespace {
+
+std::FILE *openFile(const QString &filePath)
+{
+#ifdef Q_OS_WIN
+    return _wfopen(reinterpret_cast<const wchar_t*>(filePath.utf16()), L"rb");
+#else
+    return std::fopen(QFile::encodeName(filePath).constData(), "rb");
+#endif
+}
+}
+
+// Any handler that clips natively; every strip opens the file again, so
+// this is only used where no direct decoder was built
+class ScanlineReader::QtBackend : public ScanlineReader::Backend
+{
+public:
+    explicit QtBackend(const QString &filePath)
+        : m_filePath(filePath)
+        , m_row(0)
+    {
+        QImageReader reader(filePath);
+        m_size = reader.size();
+        const QImage::Format format = reader.imageFormat();
+        const bool opaque = format != QImage::Format_Invalid
+                            && QImage::toPixelFormat(format).alphaUsage() == QPixelFormat::IgnoresAlpha;
+        m_format = opaque ? QImage::Format_RGB32 : QImage::Format_ARGB32;
+    }
+    
+    bool read(QImage *image, int row, int count) override
+    {
+        QImageReader reader(m_filePath);
+        reader.setClipRect(QRect(0, m_row, m_size.width(), count));
+        QImage strip = reader.read();
+        if (strip.isNull()) {
+            m_error = reader.errorString();
+            return false;
+        }
+        strip.convertTo(m_format);
+        for (int y = 0; y < count && y < strip.height(); ++y) {
+            std::memcpy(image->scanLine(row + y), strip.constScanLine(y),
+                        qMin(strip.bytesPerLine(), image->bytesPerLine()));
+        }
+        m_row += count;
+        return true;
+    }
+    
+    bool skip(int count) override
+    {
+        m_row += count;
+        return true;
+    }
+
+private:
+    QString m_filePath;
+    int m_row;
+};
+
+#ifdef WALLPAPERMAKER_HAVE_LIBJPEG
+namespace {
+
+struct JpegError {
+    jpeg_error_mgr manager;
+    std::jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+void jpegErrorExit(j_common_ptr info)
+{
+    JpegError *error = reinterpret_cast<JpegError*>(info->err);
+    (*info->err->format_message)(info, error->message);
+    std::longjmp(error->jump, 1);
+}
+
+void jpegOutputMessage(j_common_ptr)
+{
+    // Warnings about recoverable corruption; Qt's handler is quiet too
+}
+}
+
+class ScanlineReader::JpegBackend : public ScanlineReader::Backend
+{
+public:
+    explicit JpegBackend(std::FILE *file)
+        : m_file(file)
+        , m_created(false)
+    {
+        std::memset(&m_info, 0, sizeof(m_info));
+        m_info.err = jpeg_std_error(&m_jpegError.manager);
+        m_jpegError.manager.error_exit = jpegErrorExit;
+        m_jpegError.manager.output_message = jpegOutputMessage;
+        m_jpegError.message[0] = '\0';
+    }
+    
+    ~JpegBackend() override
+    {
+        if (m_created) {
+            jpeg_destroy_decompress(&m_info);
+        }
+        std::fclose(m_file);
+    }
+    
+    bool open()
+    {
+        if (setjmp(m_jpegError.jump)) {
+            m_error = QString::fromLocal8Bit(m_jpegError.message);
+            return false;
+        }
+        jpeg_create_decompress(&m_info);
+        m_created = true;
+        jpeg_stdio_src(&m_info, m_file);
+        jpeg_read_header(&m_info, TRUE);
+        
+        // The same conversions as Qt's handler, so strips match a full decode
+        switch (m_info.jpeg_color_space) {
+        case JCS_GRAYSCALE:
+            m_info.out_color_space = JCS_GRAYSCALE;
+            break;
+        case JCS_CMYK:
+        case JCS_YCCK:
+            m_info.out_color_space = JCS_CMYK;
+            break;
+        default:
+            m_info.out_color_space = JCS_RGB;
+            break;
+        }
+        jpeg_start_decompress(&m_info);
+        
+        m_size = QSize(static_cast<int>(m_info.output_width), static_cast<int>(m_info.output_height));
+        m_format = QImage::Format_RGB32;
+        m_samples.resize(static_cast<size_t>(m_info.output_width) * m_info.output_components);
+        return true;
+    }
+    
+    bool read(QImage *image, int row, int count) override
+    {
+        if (setjmp(m_jpegError.jump)) {
+            m_error = QString::fromLocal8Bit(m_jpegError.message);
+            return false;
+        }
+        for (int y = 0; y < count; ++y) {
+            JSAMPROW samples = m_samples.data();
+            if (jpeg_read_scanlines(&m_info, &samples, 1) != 1) {
+                m_error = "Premature end of JPEG data";
+                return false;
+            }
+            convertRow(reinterpret_cast<QRgb*>(image->scanLine(row + y)));
+        }
+        return true;
+    }
+
+private:
+    std::FILE *m_file;
+    bool m_created;
+    jpeg_decompress_struct m_info;
+    JpegError m_jpegError;
+    std::vector<JSAMPLE> m_samples;
+    
+    void convertRow(QRgb *out) const
+    {
+        const JSAMPLE *in = m_samples.data();
+        const int width = m_size.width();
+        switch (m_info.out_color_space) {
+        case JCS_GRAYSCALE:
+            for (int x = 0; x < width; ++x) {
+                out[x] = qRgb(in[x], in[x], in[x]);
+            }
+            break;
+        case JCS_CMYK:
+            // Adobe writes inverted CMYK, which Qt assumes for every file
+            for (int x = 0; x < width; ++x, in += 4) {
+                const int k = in[3];
+                out[x] = qRgb(k * in[0] / 255, k * in[1] / 255, k * in[2] / 255);
+            }
+            break;
+        default:
+            for (int x = 0; x < width; ++x, in += 3) {
+                out[x] = qRgb(in[0], in[1], in[2]);
+            }
+            break;
+        }
+    }
+};
+#endif // WALLPAPERMAKER_HAVE_LIBJPEG
+
+#ifdef WALLPAPERMAKER_HAVE_LIBPNG
+class ScanlineReader::PngBackend : public ScanlineReader::Backend
+{
+public:
+    explicit PngBackend(std::FILE *file)
+        : m_file(file)
+        , m_png(nullptr)
+        , m_info(nullptr)
+    {
+        m_message[0] = '\0';
+    }
+    
+    ~PngBackend() override
+    {
+        if (m_png) {
+            png_destroy_read_struct(&m_png, m_info ? &m_info : nullptr, nullptr);
+        }
+        std::fclose(m_file);
+    }
+    
+    bool open()
+    {
+        m_png = png_create_read_struct(PNG_LIBPNG_VER_STRING, this, pngError, pngWarning);
+        if (!m_png) {
+            m_error = "Cannot create a PNG decoder";
+            return false;
+        }
+        m_info = png_create_info_struct(m_png);
+        if (!m_info) {
+            m_error = "Cannot create a PNG decoder";
+            return false;
+        }
+        if (setjmp(png_jmpbuf(m_png))) {
+            m_error = QString::fromLocal8Bit(m_message);
+            return false;
+        }
+        
+        png_init_io(m_png, m_file);
+        png_read_info(m_png, m_info);
+        
+        // Rows of an interlaced file are only complete after the last pass
+        if (png_get_interlace_type(m_png, m_info) != PNG_INTERLACE_NONE) {
+            m_error = "Interlaced PNG files cannot be read in strips";
+            return false;
+        }
+        
+        const int colorType = png_get_color_type(m_png, m_info);
+        const bool alpha = (colorType & PNG_COLOR_MASK_ALPHA) || png_get_valid(m_png, m_info, PNG_INFO_tRNS);
+        
+        // Everything becomes 8-bit RGBA. 16-bit samples are rounded to the
+        // nearest 8-bit value, as Qt does when converting its 16-bit decode
+        png_set_expand(m_png);
+        png_set_scale_16(m_png);
+        png_set_gray_to_rgb(m_png);
+        if (!alpha) {
+            png_set_filler(m_png, 0xff, PNG_FILLER_AFTER);
+        }
+        png_read_update_info(m_png, m_info);
+        
+        m_size = QSize(static_cast<int>(png_get_image_width(m_png, m_info)),
+                       static_cast<int>(png_get_image_height(m_png, m_info)));
+        m_format = alpha ? QImage::Format_ARGB32 : QImage::Format_RGB32;
+        m_samples.resize(png_get_rowbytes(m_png, m_info));
+        return true;
+    }
+    
+    bool read(QImage *image, int row, int count) override
+    {
+        if (setjmp(png_jmpbuf(m_png))) {
+            m_error = QString::fromLocal8Bit(m_message);
+            return false;
+        }
+        const int width = m_size.width();
+        for (int y = 0; y < count; ++y) {
+            png_read_row(m_png, m_samples.data(), nullptr);
+            const png_byte *in = m_samples.data();
+            QRgb *out = reinterpret_cast<QRgb*>(image->scanLine(row + y));
+            for (int x = 0; x < width; ++x, in += 4) {
+                out[x] = qRgba(in[0], in[1], in[2], in[3]);
+            }
+        }
+        return true;
+    }
+
+private:
+    std::FILE *m_file;
+    png_structp m_png;
+    png_infop m_info;
+    std::vector<png_byte> m_samples;
+    char m_message[256];
+    
+    static void pngError(png_structp png, png_const_charp message)
+    {
+        PngBackend *backend = static_cast<PngBackend*>(png_get_error_ptr(png));
+        std::snprintf(backend->m_message, sizeof(backend->m_message), "%s", message);
+        png_longjmp(png, 1);
+    }
+    
+    static void pngWarning(png_structp, png_const_charp)
+    {
+    }
+};
+#endif // WALLPAPERMAKER_HAVE_LIBPNG
+
+#ifdef WALLPAPERMAKER_HAVE_LIBTIFF
+// Through libtiff's RGBA interface, which handles strips and tiles and
+// every photometric interpretation. Rows are addressed directly, so a
+// strip decodes only the TIFF strips or tiles it overlaps.
+class ScanlineReader::TiffBackend : public ScanlineReader::Backend
+{
+public:
+    explicit TiffBackend(const QString &filePath)
+        : m_started(false)
+        , m_row(0)
+    {
+#ifdef Q_OS_WIN
+        m_tiff = TIFFOpenW(reinterpret_cast<const wchar_t*>(filePath.utf16()), "r");
+#else
+        m_tiff = TIFFOpen(QFile::encodeName(filePath).constData(), "r");
+#endif
+    }
+    
+    ~TiffBackend() override
+    {
+        if (m_started) {
+            TIFFRGBAImageEnd(&m_image);
+        }
+        if (m_tiff) {
+            TIFFClose(m_tiff);
+        }
+    }
+    
+    bool open()
+    {
+        char message[1024] = {0};
+        if (!m_tiff) {
+            m_error = "Cannot open the TIFF file";
+            return false;
+        }
+        if (!TIFFRGBAImageOK(m_tiff, message) || !TIFFRGBAImageBegin(&m_image, m_tiff, 0, message)) {
+            m_error = QString::fromLocal8Bit(message);
+            return false;
+        }
+        m_started = true;
+        // Rows in file order, unflipped, like the other decoders
+        m_image.req_orientation = m_image.orientation;
+        
+        m_size = QSize(static_cast<int>(m_image.width), static_cast<int>(m_image.height));
+        // libtiff premultiplies unassociated alpha
+        m_format = m_image.alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+        return true;
+    }
+    
+    bool read(QImage *image, int row, int count) override
+    {
+        // 32-bit image rows are contiguous, so the raster goes straight into
+        // the strip and is swizzled in place
+        uint32_t *raster = reinterpret_cast<uint32_t*>(image->scanLine(row));
+        m_image.row_offset = m_row;
+        m_image.col_offset = 0;
+        if (!TIFFRGBAImageGet(&m_image, raster, static_cast<uint32_t>(m_size.width()),
+                              static_cast<uint32_t>(count))) {
+            m_error = QString("Cannot decode TIFF rows %1 to %2").arg(m_row).arg(m_row + count);
+            return false;
+        }
+        
+        const qsizetype pixels = static_cast<qsizetype>(m_size.width()) * count;
+        for (qsizetype i = 0; i < pixels; ++i) {
+            const uint32_t pixel = raster[i];
+            raster[i] = qRgba(TIFFGetR(pixel), TIFFGetG(pixel), TIFFGetB(pixel), TIFFGetA(pixel));
+        }
+        m_row += count;
+        return true;
+    }
+    
+    bool skip(int count) override
+    {
+        m_row += count;
+        return true;
+    }
+
+private:
+    TIFF *m_tiff;
+    TIFFRGBAImage m_image;
+    bool m_started;
+    int m_row;
+};
+#endif // WALLPAPERMAKER_HAVE_LIBTIFF
+
+ScanlineReader::ScanlineReader(const QString &filePath)
+    : m_stripFirst(0)
+    , m_nextRow(0)
+{
+    QImageReader probe(filePath);
+    const QByteArray format = probe.format();
+    if (format.isEmpty()) {
+        m_error = probe.errorString();
+        return;
+    }
+
+#ifdef WALLPAPERMAKER_HAVE_LIBJPEG
+    if (format == "jpeg" || format == "jpg") {
+        std::FILE *file = openFile(filePath);
+        if (!file) {
+            m_error = QString("Cannot open %1").arg(filePath);
+            return;
+        }
+        auto backend = std::make_unique<JpegBackend>(file);
+        if (!backend->open()) {
+            m_error = backend->errorString();
+            return;
+        }
+        m_backend = std::move(backend);
+        return;
+    }
+#endif
+#ifdef WALLPAPERMAKER_HAVE_LIBPNG
+    if (format == "png") {
+        std::FILE *file = openFile(filePath);
+        if (!file) {
+            m_error = QString("Cannot open %1").arg(filePath);
+            return;
+        }
+        auto backend = std::make_unique<PngBackend>(file);
+        if (!backend->open()) {
+            m_error = backend->errorString();
+            return;
+        }
+        m_backend = std::move(backend);
+        return;
+    }
+#endif
+#ifdef WALLPAPERMAKER_HAVE_LIBTIFF
+    if (format == "tiff" || format == "tif") {
+        auto backend = std::make_unique<TiffBackend>(filePath);
+        if (!backend->open()) {
+            m_error = backend->errorString();
+            return;
+        }
+        m_backend = std::move(backend);
+        return;
+    }
+#endif
+
+    if (probe.supportsOption(QImageIOHandler::ClipRect) && probe.size().isValid()) {
+        m_backend = std::make_unique<QtBackend>(filePath);
+        return;
+    }
+    m_error = QString("%1 images cannot be read in strips").arg(QString::fromLatin1(format.toUpper()));
+}
+
+ScanlineReader::~ScanlineReader() = default;
+
+QSize ScanlineReader::size() const
+{
+    return m_backend ? m_backend->size() : QSize();
+}
+
+QImage ScanlineReader::read(int first, int last)
+{
+    TRACE_SCOPE("ScanlineReader::read");
+    if (!m_backend) {
+        return QImage();
+    }
+    const QSize size = m_backend->size();
+    if (first < m_stripFirst || last < m_nextRow || first >= last || last > size.height()) {
+        m_error = QString("Rows %1 to %2 requested out of order").arg(first).arg(last);
+        return QImage();
+    }
+    
+    QImage strip(size.width(), last - first, m_backend->format());
+    if (strip.isNull()) {
+        m_error = "Not enough memory for an image strip";
+        return QImage();
+    }
+    
+    // Rows already decoded for the previous strip
+    const int reused = qMax(0, m_nextRow - first);
+    for (int y = 0; y < reused; ++y) {
+        std::memcpy(strip.scanLine(y), m_strip.constScanLine(first - m_stripFirst + y),
+                    static_cast<size_t>(strip.bytesPerLine()));
+    }
+    m_strip = QImage();
+    
+    if (first > m_nextRow) {
+        if (!m_backend->skip(first - m_nextRow)) {
+            m_error = m_backend->errorString();
+            return QImage();
+        }
+        m_nextRow = first;
+    }
+    if (last > m_nextRow && !m_backend->read(&strip, m_nextRow - first, last - m_nextRow)) {
+        m_error = m_backend->errorString();
+        return QImage();
+    }
+    
+    m_strip = strip;
+    m_stripFirst = first;
+    m_nextRow = last;
+    return strip;
+}
@@ -0,0 +1,53 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef SCANLINEREADER_H
+#define SCANLINEREADER_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <memory>
+
+// Reads an image file from top to bottom in strips of full-width rows, for
+// sources too large to decode at once. JPEG, PNG and TIFF are decoded with
+// libjpeg, libpng and libtiff where the build found them, keeping one
+// decoder open so every row is decoded once. Other formats whose Qt handler
+// clips natively are read a strip at a time through QImageReader; anything
+// else cannot be streamed. Strips must come in order: each may start and
+// end no earlier than the one before, and rows the two share are reused
+// rather than decoded again. Orientation metadata is not applied.
+class ScanlineReader
+{
+public:
+    explicit ScanlineReader(const QString &filePath);
+    ~ScanlineReader();
+    
+    ScanlineReader(const ScanlineReader &) = delete;
+    ScanlineReader &operator=(const ScanlineReader &) = delete;
+    
+    bool isValid() const { return m_backend != nullptr; } // False if the file cannot be streamed
+    QSize size() const;
+    QString errorString() const { return m_error; }
+    
+    // Rows [first, last) of the image, or a null image on error
+    QImage read(int first, int last);
+
+private:
+    class Backend;
+    class QtBackend;
+    class JpegBackend;
+    class PngBackend;
+    class TiffBackend;
+    
+    std::unique_ptr<Backend> m_backend;
+    QString m_error;
+    QImage m_strip;           // The last strip returned, for its overlap with the next
+    int m_stripFirst;
+    int m_nextRow;            // First row the decoder has not produced
+};
+
+#endif // SCANLINEREADER_H
@@ -5,6 +5,7 @@
 //  See the LICENSE file for full details
 //===========================================
 #include "SettingsDialog.h"
+#include "ImageProcessor.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFormLayout>
@@ -12,6 +13,8 @@
 #include <QComboBox>
 #include <QSlider>
 #include <QCheckBox>
+#include <QSpinBox>
+#include <QThread>
 #include <QLabel>
 #include <QPushButton>
 #include <QDialogButtonBox>
@@ -25,6 +28,12 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     , m_qualityLabel(nullptr)
     , m_rememberAdjustmentsCheckBox(nullptr)
     , m_autoFitCheckBox(nullptr)
+    , m_threadsSpinBox(nullptr)
+    , m_memoryBudgetSpinBox(nullptr)
+    , m_decodeCacheSpinBox(nullptr)
+    , m_proxyCacheSpinBox(nullptr)
+    , m_prefetchDepthSpinBox(nullptr)
+    , m_prefetchMemorySpinBox(nullptr)
     , m_resetButton(nullptr)
     , m_okButton(nullptr)
     , m_cancelButton(nullptr)
@@ -33,6 +42,7 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     , m_buttonLayout(nullptr)
     , m_exportGroup(nullptr)
     , m_behaviorGroup(nullptr)
+    , m_performanceGroup(nullptr)
 {
     setWindowTitle("Preferences");
     setModal(true);
@@ -72,6 +82,22 @@ void SettingsDialog::setupUI()
     
     m_formLayout->addRow("JPEG Quality:", qualityLayout);
     
+    // Encoder effort for the formats where it changes anything
+    for (ImageProcessor::OutputFormat format : ImageProcessor::getAvailableOutputFormats()) {
+        ImageProcessor::FormatInfo info = ImageProcessor::getFormatInfo(format);
+        if (info.speedPresets.isEmpty()) {
+            continue;
+        }
+        QComboBox *comboBox = new QComboBox(this);
+        for (auto speed : {ImageProcessor::EncoderSpeed::Fast, ImageProcessor::EncoderSpeed::Balanced,
+                           ImageProcessor::EncoderSpeed::Smallest}) {
+            comboBox->addItem(ImageProcessor::encoderSpeedName(speed), static_cast<int>(speed));
+        }
+        comboBox->setToolTip("Fast encodes quickest, Smallest gives the smallest files");
+        m_formLayout->addRow(QString("%1 Encoder:").arg(info.description.section(' ', 0, 0)), comboBox);
+        m_encoderSpeedComboBoxes.insert(format, comboBox);
+    }
+    
     m_mainLayout->addWidget(m_exportGroup);
     
     // Behavior settings group
@@ -86,6 +112,59 @@ void SettingsDialog::setupUI()
     
     m_mainLayout->addWidget(m_behaviorGroup);
     
+    // Performance settings group
+    m_performanceGroup = new QGroupBox("Performance Settings", this);
+    QFormLayout *performanceLayout = new QFormLayout(m_performanceGroup);
+    
+    m_threadsSpinBox = new QSpinBox(this);
+    m_threadsSpinBox->setRange(0, qMax(1, QThread::idealThreadCount()));
+    m_threadsSpinBox->setSpecialValueText("Automatic");
+    m_threadsSpinBox->setToolTip("Maximum number of threads used for image processing");
+    performanceLayout->addRow("Processing Threads:", m_threadsSpinBox);
+    
+    m_memoryBudgetSpinBox = new QSpinBox(this);
+    m_memoryBudgetSpinBox->setRange(256, ImageProcessor::MaxMemoryBudgetMB);
+    m_memoryBudgetSpinBox->setSingleStep(256);
+    m_memoryBudgetSpinBox->setSuffix(" MB");
+    m_memoryBudgetSpinBox->setToolTip("Largest image kept fully in memory; bigger images are "
+                                      "previewed from a reduced copy and exported in strips");
+    performanceLayout->addRow("Memory Budget:", m_memoryBudgetSpinBox);
+    
+    m_decodeCacheSpinBox = new QSpinBox(this);
+    m_decodeCacheSpinBox->setRange(0, 64 * 1024);
+    m_decodeCacheSpinBox->setSingleStep(128);
+    m_decodeCacheSpinBox->setSuffix(" MB");
+    m_decodeCacheSpinBox->setSpecialValueText("Off");
+    m_decodeCacheSpinBox->setToolTip("Memory for keeping recently opened images decoded, "
+                                     "so switching back to them is instant");
+    performanceLayout->addRow("Decoded Image Cache:", m_decodeCacheSpinBox);
+    
+    m_proxyCacheSpinBox = new QSpinBox(this);
+    m_proxyCacheSpinBox->setRange(0, 64 * 1024);
+    m_proxyCacheSpinBox->setSingleStep(256);
+    m_proxyCacheSpinBox->setSuffix(" MB");
+    m_proxyCacheSpinBox->setSpecialValueText("Off");
+    m_proxyCacheSpinBox->setToolTip("Disk space for screen-sized previews of opened images, "
+                                    "shown while large files decode");
+    performanceLayout->addRow("Preview Disk Cache:", m_proxyCacheSpinBox);
+    
+    m_prefetchDepthSpinBox = new QSpinBox(this);
+    m_prefetchDepthSpinBox->setRange(0, 5);
+    m_prefetchDepthSpinBox->setSpecialValueText("Off");
+    m_prefetchDepthSpinBox->setToolTip("Images on each side of the current one in its folder to decode "
+                                       "in the background, for Next/Previous Image");
+    performanceLayout->addRow("Prefetch Neighbours:", m_prefetchDepthSpinBox);
+    
+    m_prefetchMemorySpinBox = new QSpinBox(this);
+    m_prefetchMemorySpinBox->setRange(64, 16 * 1024);
+    m_prefetchMemorySpinBox->setSingleStep(128);
+    m_prefetchMemorySpinBox->setSuffix(" MB");
+    m_prefetchMemorySpinBox->setToolTip("Most memory prefetched images may take; prefetched images "
+                                        "are held in the decoded image cache");
+    performanceLayout->addRow("Prefetch Memory:", m_prefetchMemorySpinBox);
+    
+    m_mainLayout->addWidget(m_performanceGroup);
+    
     // Button layout
     m_buttonLayout = new QHBoxLayout();
     
@@ -138,6 +217,9 @@ void SettingsDialog::populateFormatComboBox()
                              static_cast<int>(ImageProcessor::OutputFormat::BMP));
     m_formatComboBox->addItem("TIFF (Tagged Image File Format)", 
                              static_cast<int>(ImageProcessor::OutputFormat::TIFF));
+    if (ImageProcessor::isOutputFormatAvailable(ImageProcessor::OutputFormat::WEBP)) {
+        m_formatComboBox->addItem("WebP", static_cast<int>(ImageProcessor::OutputFormat::WEBP));
+    }
 }
 
 ImageProcessor::OutputFormat SettingsDialog::getDefaultExportFormat() const
@@ -161,6 +243,45 @@ bool SettingsDialog::getAutoFitOnLoad() const
     return m_autoFitCheckBox->isChecked();
 }
 
+int SettingsDialog::getMaxProcessingThreads() const
+{
+    return m_threadsSpinBox->value();
+}
+
+int SettingsDialog::getMemoryBudgetMB() const
+{
+    return m_memoryBudgetSpinBox->value();
+}
+
+int SettingsDialog::getDecodeCacheMB() const
+{
+    return m_decodeCacheSpinBox->value();
+}
+
+int SettingsDialog::getProxyCacheMB() const
+{
+    return m_proxyCacheSpinBox->value();
+}
+
+int SettingsDialog::getPrefetchDepth() const
+{
+    return m_prefetchDepthSpinBox->value();
+}
+
+int SettingsDialog::getPrefetchMemoryMB() const
+{
+    return m_prefetchMemorySpinBox->value();
+}
+
+ImageProcessor::EncoderSpeed SettingsDialog::getEncoderSpeed(ImageProcessor::OutputFormat format) const
+{
+    QComboBox *comboBox = m_encoderSpeedComboBoxes.value(format);
+    if (!comboBox) {
+        return ImageProcessor::EncoderSpeed::Balanced;
+    }
+    return static_cast<ImageProcessor::EncoderSpeed>(comboBox->currentData().toInt());
+}
+
 void SettingsDialog::setDefaultExportFormat(ImageProcessor::OutputFormat format)
 {
     int index = m_formatComboBox->findData(static_cast<int>(format));
@@ -184,6 +305,49 @@ void SettingsDialog::setAutoFitOnLoad(bool autoFit)
     m_autoFitCheckBox->setChecked(autoFit);
 }
 
+void SettingsDialog::setMaxProcessingThreads(int threads)
+{
+    m_threadsSpinBox->setValue(qBound(0, threads, m_threadsSpinBox->maximum()));
+}
+
+void SettingsDialog::setMemoryBudgetMB(int megabytes)
+{
+    m_memoryBudgetSpinBox->setValue(megabytes);
+}
+
+void SettingsDialog::setDecodeCacheMB(int megabytes)
+{
+    m_decodeCacheSpinBox->setValue(megabytes);
+}
+
+void SettingsDialog::setProxyCacheMB(int megabytes)
+{
+    m_proxyCacheSpinBox->setValue(megabytes);
+}
+
+void SettingsDialog::setPrefetchDepth(int depth)
+{
+    m_prefetchDepthSpinBox->setValue(depth);
+}
+
+void SettingsDialog::setPrefetchMemoryMB(int megabytes)
+{
+    m_prefetchMemorySpinBox->setValue(megabytes);
+}
+
+void SettingsDialog::setEncoderSpeed(ImageProcessor::OutputFormat format, ImageProcessor::EncoderSpeed speed)
+{
+    QComboBox *comboBox = m_encoderSpeedComboBoxes.value(format);
+    if (comboBox) {
+        comboBox->setCurrentIndex(qMax(0, comboBox->findData(static_cast<int>(speed))));
+    }
+}
+
+QString SettingsDialog::encoderSpeedKey(ImageProcessor::OutputFormat format)
+{
+    return QString("EncoderSpeed/%1").arg(ImageProcessor::getFormatInfo(format).extension);
+}
+
 void SettingsDialog::loadSettings()
 {
     QSettings settings;
@@ -203,6 +367,24 @@ void SettingsDialog::loadSettings()
     
     bool autoFit = settings.value("AutoFitOnLoad", true).toBool();
     setAutoFitOnLoad(autoFit);
+    
+    // Load performance settings
+    int threads = settings.value("MaxProcessingThreads", 0).toInt();
+    setMaxProcessingThreads(threads);
+    
+    int memoryBudget = settings.value("MemoryBudgetMB", ImageProcessor::DefaultMemoryBudgetMB).toInt();
+    setMemoryBudgetMB(memoryBudget);
+    setDecodeCacheMB(settings.value("DecodeCacheMB", ImageProcessor::DefaultDecodeCacheMB).toInt());
+    setProxyCacheMB(settings.value("ProxyCacheMB", ImageProcessor::DefaultProxyCacheMB).toInt());
+    setPrefetchDepth(settings.value("PrefetchDepth", ImageProcessor::DefaultPrefetchDepth).toInt());
+    setPrefetchMemoryMB(settings.value("PrefetchMemoryMB", ImageProcessor::DefaultPrefetchMemoryMB).toInt());
+    
+    // Load encoder speeds
+    for (auto it = m_encoderSpeedComboBoxes.begin(); it != m_encoderSpeedComboBoxes.end(); ++it) {
+        int speed = settings.value(encoderSpeedKey(it.key()),
+                                   static_cast<int>(ImageProcessor::EncoderSpeed::Balanced)).toInt();
+        setEncoderSpeed(it.key(), static_cast<ImageProcessor::EncoderSpeed>(speed));
+    }
 }
 
 void SettingsDialog::saveSettings()
@@ -218,6 +400,19 @@ void SettingsDialog::saveSettings()
     // Save behavior settings
     settings.setValue("RememberAdjustments", getRememberAdjustments());
     settings.setValue("AutoFitOnLoad", getAutoFitOnLoad());
+    
+    // Save performance settings
+    settings.setValue("MaxProcessingThreads", getMaxProcessingThreads());
+    settings.setValue("MemoryBudgetMB", getMemoryBudgetMB());
+    settings.setValue("DecodeCacheMB", getDecodeCacheMB());
+    settings.setValue("ProxyCacheMB", getProxyCacheMB());
+    settings.setValue("PrefetchDepth", getPrefetchDepth());
+    settings.setValue("PrefetchMemoryMB", getPrefetchMemoryMB());
+    
+    // Save encoder speeds
+    for (auto it = m_encoderSpeedComboBoxes.begin(); it != m_encoderSpeedComboBoxes.end(); ++it) {
+        settings.setValue(encoderSpeedKey(it.key()), static_cast<int>(getEncoderSpeed(it.key())));
+    }
 }
 
 void SettingsDialog::resetToDefaults()
@@ -226,6 +421,15 @@ void SettingsDialog::resetToDefaults()
     setDefaultJpegQuality(85);
     setRememberAdjustments(true);
     setAutoFitOnLoad(true);
+    setMaxProcessingThreads(0);
+    setMemoryBudgetMB(ImageProcessor::DefaultMemoryBudgetMB);
+    setDecodeCacheMB(ImageProcessor::DefaultDecodeCacheMB);
+    setProxyCacheMB(ImageProcessor::DefaultProxyCacheMB);
+    setPrefetchDepth(ImageProcessor::DefaultPrefetchDepth);
+    setPrefetchMemoryMB(ImageProcessor::DefaultPrefetchMemoryMB);
+    for (auto it = m_encoderSpeedComboBoxes.begin(); it != m_encoderSpeedComboBoxes.end(); ++it) {
+        setEncoderSpeed(it.key(), ImageProcessor::EncoderSpeed::Balanced);
+    }
 }
 
 void SettingsDialog::onFormatChanged()
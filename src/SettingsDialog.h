@@ -11,6 +11,7 @@
 #include <QComboBox>
 #include <QSlider>
 #include <QCheckBox>
+#include <QSpinBox>
 #include <QLabel>
 #include <QPushButton>
 #include <QVBoxLayout>
@@ -18,6 +19,7 @@
 #include <QFormLayout>
 #include <QGroupBox>
 #include <QSettings>
+#include <QMap>
 #include "ImageProcessor.h"
 
 class SettingsDialog : public QDialog
@@ -32,12 +34,29 @@ public:
     int getDefaultJpegQuality() const;
     bool getRememberAdjustments() const;
     bool getAutoFitOnLoad() const;
+    int getMaxProcessingThreads() const;
+    int getMemoryBudgetMB() const;
+    int getDecodeCacheMB() const;
+    int getProxyCacheMB() const;
+    int getPrefetchDepth() const;
+    int getPrefetchMemoryMB() const;
+    ImageProcessor::EncoderSpeed getEncoderSpeed(ImageProcessor::OutputFormat format) const;
     
     // Settings modification
     void setDefaultExportFormat(ImageProcessor::OutputFormat format);
     void setDefaultJpegQuality(int quality);
     void setRememberAdjustments(bool remember);
     void setAutoFitOnLoad(bool autoFit);
+    void setMaxProcessingThreads(int threads);
+    void setMemoryBudgetMB(int megabytes);
+    void setDecodeCacheMB(int megabytes);
+    void setProxyCacheMB(int megabytes);
+    void setPrefetchDepth(int depth);
+    void setPrefetchMemoryMB(int megabytes);
+    void setEncoderSpeed(ImageProcessor::OutputFormat format, ImageProcessor::EncoderSpeed speed);
+    
+    // QSettings key holding the encoder speed of a format
+    static QString encoderSpeedKey(ImageProcessor::OutputFormat format);
 
 public slots:
     void loadSettings();
@@ -57,6 +76,13 @@ private:
     QLabel *m_qualityLabel;
     QCheckBox *m_rememberAdjustmentsCheckBox;
     QCheckBox *m_autoFitCheckBox;
+    QSpinBox *m_threadsSpinBox;
+    QSpinBox *m_memoryBudgetSpinBox;
+    QSpinBox *m_decodeCacheSpinBox;
+    QSpinBox *m_proxyCacheSpinBox;
+    QSpinBox *m_prefetchDepthSpinBox;
+    QSpinBox *m_prefetchMemorySpinBox;
+    QMap<ImageProcessor::OutputFormat, QComboBox*> m_encoderSpeedComboBoxes;
     QPushButton *m_resetButton;
     QPushButton *m_okButton;
     QPushButton *m_cancelButton;
@@ -67,6 +93,7 @@ private:
     QHBoxLayout *m_buttonLayout;
     QGroupBox *m_exportGroup;
     QGroupBox *m_behaviorGroup;
+    QGroupBox *m_performanceGroup;
     
     void setupUI();
     void setupConnections();
@@ -0,0 +1,216 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "ThumbnailCache.h"
+#include "Resampler.h"
+#include "Trace.h"
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QDateTime>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QUrl>
+
+namespace {
+
+// Shared thumbnail sizes good enough to stand in for a proxy, largest first
+const char *const kThumbnailSizes[] = {"xx-large", "x-large"};
+
+// zlib level 1; see the PNG speed presets in ImageProcessor
+const int kPngQuality = 89;
+
+const QFileDevice::Permissions kPrivateFile = QFileDevice::ReadOwner | QFileDevice::WriteOwner;
+const QFileDevice::Permissions kPrivateDirectory = kPrivateFile | QFileDevice::ExeOwner;
+}
+
+ThumbnailCache::ThumbnailCache(qint64 budgetBytes)
+    : m_budget(qMax<qint64>(0, budgetBytes))
+{
+}
+
+QString ThumbnailCache::proxyDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/proxies";
+}
+
+QString ThumbnailCache::thumbnailDirectory()
+{
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MACOS)
+    // Follows XDG_CACHE_HOME, as the spec asks
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/thumbnails";
+#else
+    return QString();
+#endif
+}
+
+QImage ThumbnailCache::lookup(const QString &filePath, QSize *sourceSize) const
+{
+    TRACE_SCOPE("ThumbnailCache::lookup");
+    QFileInfo info(filePath);
+    if (m_budget == 0 || !info.exists()) {
+        return QImage();
+    }
+    
+    const QString uri = fileUri(info);
+    const QString name = entryName(uri);
+    QStringList candidates = {QDir(proxyDirectory()).filePath(name)};
+    const QString thumbnails = thumbnailDirectory();
+    if (!thumbnails.isEmpty()) {
+        for (const char *size : kThumbnailSizes) {
+            candidates << QString("%1/%2/%3").arg(thumbnails, QLatin1String(size), name);
+        }
+    }
+    
+    for (const QString &path : candidates) {
+        QImageReader reader(path, "png");
+        if (!isCurrent(reader, uri, info)) {
+            continue;
+        }
+        QImage image = reader.read();
+        if (image.isNull()) {
+            continue;
+        }
+        
+        // Written by us with the source dimensions; other thumbnailers
+        // may leave them out
+        *sourceSize = QSize(reader.text("Thumb::Image::Width").toInt(),
+                            reader.text("Thumb::Image::Height").toInt());
+        if (sourceSize->isEmpty()) {
+            *sourceSize = QImageReader(filePath).size();
+        }
+        return image;
+    }
+    return QImage();
+}
+
+void ThumbnailCache::store(const QString &filePath, const QImage &proxy, const QSize &sourceSize)
+{
+    QFileInfo info(filePath);
+    const qint64 budget = m_budget;
+    if (budget == 0 || proxy.isNull() || !info.exists()) {
+        return;
+    }
+    
+    const QString uri = fileUri(info);
+    const QString name = entryName(uri);
+    const QString proxyPath = QDir(proxyDirectory()).filePath(name);
+    {
+        QImageReader existing(proxyPath, "png");
+        if (isCurrent(existing, uri, info)) {
+            return;
+        }
+    }
+    
+    TRACE_SCOPE("ThumbnailCache::store");
+    // A cache; a failed write only costs a decode next time
+    if (writeEntry(proxyPath, proxy, uri, info, sourceSize)) {
+        prune(budget);
+    }
+    
+    // Share an xx-large thumbnail with file managers, unless the source is
+    // itself a thumbnail
+    const QString thumbnails = thumbnailDirectory();
+    if (thumbnails.isEmpty() || info.absoluteFilePath().startsWith(thumbnails + '/')) {
+        return;
+    }
+    const QString thumbnailPath = QString("%1/xx-large/%2").arg(thumbnails, name);
+    {
+        QImageReader shared(thumbnailPath, "png");
+        if (isCurrent(shared, uri, info)) {
+            return;
+        }
+    }
+    QImage thumbnail = proxy;
+    if (proxy.width() > ThumbnailMaxDimension || proxy.height() > ThumbnailMaxDimension) {
+        QSize thumbnailSize = proxy.size().scaled(ThumbnailMaxDimension, ThumbnailMaxDimension,
+                                                  Qt::KeepAspectRatio);
+        thumbnail = Resampler::resample(proxy, QRectF(proxy.rect()), thumbnailSize,
+                                        Resampler::Filter::Mitchell);
+    }
+    writeEntry(thumbnailPath, thumbnail, uri, info, sourceSize);
+}
+
+QString ThumbnailCache::fileUri(const QFileInfo &info)
+{
+    return QString::fromLatin1(QUrl::fromLocalFile(info.absoluteFilePath()).toEncoded());
+}
+
+QString ThumbnailCache::entryName(const QString &uri)
+{
+    const QByteArray digest = QCryptographicHash::hash(uri.toUtf8(), QCryptographicHash::Md5);
+    return QString::fromLatin1(digest.toHex()) + ".png";
+}
+
+bool ThumbnailCache::isCurrent(QImageReader &reader, const QString &uri, const QFileInfo &info)
+{
+    // The tags sit ahead of the pixel data, so this reads only the header.
+    // Thumb::Size is optional in the spec but checked when present.
+    if (!reader.canRead() || reader.text("Thumb::URI") != uri) {
+        return false;
+    }
+    if (reader.text("Thumb::MTime").toLongLong() != info.lastModified().toSecsSinceEpoch()) {
+        return false;
+    }
+    const QString size = reader.text("Thumb::Size");
+    return size.isEmpty() || size.toLongLong() == info.size();
+}
+
+bool ThumbnailCache::writeEntry(const QString &path, const QImage &image, const QString &uri, const QFileInfo &info,
+                                const QSize &sourceSize)
+{
+    // The spec asks for private files and directories, and for writes that
+    // readers never see half done
+    const QString directory = QFileInfo(path).absolutePath();
+    if (!QDir().mkpath(directory)) {
+        return false;
+    }
+    QFile::setPermissions(directory, kPrivateDirectory);
+    
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    
+    QImageWriter writer(&file, "png");
+    writer.setQuality(kPngQuality);
+    writer.setText("Thumb::URI", uri);
+    writer.setText("Thumb::MTime", QString::number(info.lastModified().toSecsSinceEpoch()));
+    writer.setText("Thumb::Size", QString::number(info.size()));
+    writer.setText("Thumb::Image::Width", QString::number(sourceSize.width()));
+    writer.setText("Thumb::Image::Height", QString::number(sourceSize.height()));
+    writer.setText("Software", "WallpaperMaker");
+    if (!writer.write(image)) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        return false;
+    }
+    QFile::setPermissions(path, kPrivateFile);
+    return true;
+}
+
+void ThumbnailCache::prune(qint64 budget)
+{
+    // Lookups do not touch the files, so age is time since writing
+    QFileInfoList entries = QDir(proxyDirectory()).entryInfoList({"*.png"}, QDir::Files, QDir::Time);
+    qint64 bytes = 0;
+    for (const QFileInfo &entry : entries) {
+        bytes += entry.size();
+    }
+    
+    // Newest first, so remove from the back
+    while (bytes > budget && !entries.isEmpty()) {
+        const QFileInfo oldest = entries.takeLast();
+        if (QFile::remove(oldest.absoluteFilePath())) {
+            bytes -= oldest.size();
+        }
+    }
+}
@@ -0,0 +1,57 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <atomic>
+
+class QFileInfo;
+class QImageReader;
+
+// Screen-sized proxies of opened images kept on disk, so the viewer has
+// something to show while a large file decodes. Files follow the
+// freedesktop.org thumbnail spec: PNGs named by the MD5 of the file:// URI
+// and tagged with the source's URI, modification time and size; an entry
+// is only used while the time and size still match. Proxies live in the
+// application cache directory, trimmed oldest first to the budget. An
+// xx-large thumbnail is also written to the shared thumbnail directory,
+// and existing large thumbnails there serve as proxies. Safe to use from
+// any thread.
+class ThumbnailCache
+{
+public:
+    static constexpr int ThumbnailMaxDimension = 1024; // freedesktop xx-large
+    
+    explicit ThumbnailCache(qint64 budgetBytes = 0);
+    
+    void setBudget(qint64 bytes) { m_budget = qMax<qint64>(0, bytes); } // 0 disables the cache
+    qint64 budget() const { return m_budget; }
+    
+    // A current proxy of the file, or a null image. sourceSize receives
+    // the dimensions of the file itself.
+    QImage lookup(const QString &filePath, QSize *sourceSize) const;
+    // Does nothing while a current proxy exists
+    void store(const QString &filePath, const QImage &proxy, const QSize &sourceSize);
+    
+    static QString proxyDirectory();
+    static QString thumbnailDirectory(); // Empty where the spec does not apply
+
+private:
+    std::atomic<qint64> m_budget;
+    
+    static QString fileUri(const QFileInfo &info);
+    static QString entryName(const QString &uri);
+    static bool isCurrent(QImageReader &reader, const QString &uri, const QFileInfo &info);
+    static bool writeEntry(const QString &path, const QImage &image, const QString &uri, const QFileInfo &info,
+                           const QSize &sourceSize);
+    static void prune(qint64 budget);
+};
+
+#endif // THUMBNAILCACHE_H
@@ -0,0 +1,278 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "TiledImageItem.h"
+#include "ParallelFor.h"
+#include "Trace.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <QPointer>
+#include <cmath>
+
+namespace {
+
+// Tile pixmaps kept around for panning back and forth, in KB
+const int kTileCacheKB = 192 * 1024;
+
+quint64 tileKey(int level, int column, int row)
+{
+    return (static_cast<quint64>(level) << 48) | (static_cast<quint64>(row) << 24) | static_cast<quint64>(column);
+}
+
+} // namespace
+
+TiledImageItem::TiledImageItem(const QImage &image, const QSize &sourceSize, QGraphicsItem *parent)
+    : QGraphicsObject(parent)
+    , m_sourceSize(sourceSize.isEmpty() ? image.size() : sourceSize)
+    , m_builtLevels(1)
+    , m_wantedLevel(0)
+    , m_building(false)
+    , m_cancelled(std::make_shared<std::atomic<bool>>(false))
+    , m_tileCache(kTileCacheKB)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+    resetLevels(image);
+}
+
+TiledImageItem::~TiledImageItem()
+{
+    *m_cancelled = true;
+}
+
+void TiledImageItem::setImage(const QImage &image, const QSize &sourceSize)
+{
+    TRACE_SCOPE("TiledImageItem::setImage");
+    const QSize newSourceSize = sourceSize.isEmpty() ? image.size() : sourceSize;
+    if (newSourceSize != m_sourceSize) {
+        prepareGeometryChange();
+        m_sourceSize = newSourceSize;
+    }
+    
+    // Levels still being built come from the old pixels
+    *m_cancelled = true;
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_building = false;
+    
+    resetLevels(image);
+    m_tileCache.clear();
+    m_placeholder = QPixmap();
+    
+    // Start on the levels the view was using rather than waiting for paint
+    m_wantedLevel = qMin(m_wantedLevel, levelCount() - 1);
+    if (m_wantedLevel > 0) {
+        requestLevel(m_wantedLevel);
+    }
+    update();
+}
+
+void TiledImageItem::resetLevels(const QImage &image)
+{
+    // Halve until the whole level fits in a single tile
+    QSize size = image.size();
+    m_levelSizes = {size};
+    while (size.width() > TileSize || size.height() > TileSize) {
+        size = QSize(qMax(1, (size.width() + 1) / 2), qMax(1, (size.height() + 1) / 2));
+        m_levelSizes.append(size);
+    }
+    
+    m_levels = QList<QImage>(m_levelSizes.size());
+    m_levels[0] = image;
+    m_builtLevels = 1;
+}
+
+QRectF TiledImageItem::boundingRect() const
+{
+    return QRectF(QPointF(0, 0), m_sourceSize);
+}
+
+qint64 TiledImageItem::pyramidBytes() const
+{
+    qint64 bytes = 0;
+    for (int level = 1; level < m_levels.size(); ++level) {
+        bytes += m_levels[level].sizeInBytes();
+    }
+    return bytes;
+}
+
+int TiledImageItem::levelForScale(qreal scale) const
+{
+    // Coarsest level that still has at least one pixel per device pixel
+    qreal requiredWidth = m_sourceSize.width() * scale;
+    int level = 0;
+    while (level + 1 < m_levelSizes.size() && m_levelSizes[level + 1].width() >= requiredWidth) {
+        ++level;
+    }
+    return level;
+}
+
+void TiledImageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(widget);
+    
+    qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    scale *= painter->device()->devicePixelRatio();
+    
+    int wanted = levelForScale(scale);
+    if (wanted >= m_builtLevels) {
+        requestLevel(wanted);
+    }
+    // Fall back to the next finer level while the wanted one is built; much
+    // finer levels would cost more tiles than a moment of lower quality
+    int level = qMin(wanted, m_builtLevels - 1);
+    if (wanted - level > 1) {
+        painter->drawPixmap(boundingRect(), placeholder(), QRectF(placeholder().rect()));
+        return;
+    }
+    
+    const QSize levelSize = m_levelSizes[level];
+    const qreal sx = static_cast<qreal>(m_sourceSize.width()) / levelSize.width();
+    const qreal sy = static_cast<qreal>(m_sourceSize.height()) / levelSize.height();
+    
+    QRectF exposed = option->exposedRect.intersected(boundingRect());
+    if (exposed.isEmpty()) {
+        return;
+    }
+    
+    int firstColumn = qMax(0, static_cast<int>(std::floor(exposed.left() / sx / TileSize)));
+    int lastColumn = qMin((levelSize.width() - 1) / TileSize,
+                          static_cast<int>(std::floor(exposed.right() / sx / TileSize)));
+    int firstRow = qMax(0, static_cast<int>(std::floor(exposed.top() / sy / TileSize)));
+    int lastRow = qMin((levelSize.height() - 1) / TileSize,
+                       static_cast<int>(std::floor(exposed.bottom() / sy / TileSize)));
+    
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            QPixmap tile = tilePixmap(level, column, row);
+            QRectF target(column * TileSize * sx, row * TileSize * sy,
+                          tile.width() * sx, tile.height() * sy);
+            painter->drawPixmap(target, tile, QRectF(tile.rect()));
+        }
+    }
+}
+
+QPixmap TiledImageItem::tilePixmap(int level, int column, int row)
+{
+    quint64 key = tileKey(level, column, row);
+    if (QPixmap *cached = m_tileCache.object(key)) {
+        return *cached;
+    }
+    
+    const QImage &source = m_levels[level];
+    QRect rect(column * TileSize, row * TileSize, TileSize, TileSize);
+    QPixmap tile;
+    {
+        TRACE_SCOPE("QPixmap::fromImage");
+        tile = QPixmap::fromImage(source.copy(rect.intersected(source.rect())));
+    }
+    
+    int cost = qMax(1, static_cast<int>(tile.width() * tile.height() * 4 / 1024));
+    m_tileCache.insert(key, new QPixmap(tile), cost);
+    return tile;
+}
+
+const QPixmap &TiledImageItem::placeholder()
+{
+    // Nearest-neighbour sampling reads only the output's pixels, so this is
+    // cheap even for a 16K image; it only fills in until the build lands
+    if (m_placeholder.isNull()) {
+        TRACE_SCOPE("TiledImageItem::placeholder");
+        m_placeholder = QPixmap::fromImage(m_levels[0].scaled(m_levelSizes.last(), Qt::IgnoreAspectRatio,
+                                                              Qt::FastTransformation));
+    }
+    return m_placeholder;
+}
+
+void TiledImageItem::requestLevel(int level)
+{
+    m_wantedLevel = qMax(m_wantedLevel, level);
+    if (m_building || m_wantedLevel < m_builtLevels) {
+        return;
+    }
+    
+    m_building = true;
+    const int first = m_builtLevels;
+    const int last = m_wantedLevel;
+    const QImage start = m_levels[first - 1];
+    QPointer<TiledImageItem> guard(this);
+    std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+    
+    // Each level is built from the previous one, so only the first step
+    // touches the full-resolution image
+    QThreadPool::globalInstance()->start([guard, cancelled, start, first, last]() {
+        QImage image = start;
+        for (int level = first; level <= last && !*cancelled; ++level) {
+            image = halveImage(image);
+            bool finished = (level == last);
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [guard, cancelled, level, image, finished]() {
+                if (guard && !*cancelled) {
+                    guard->onLevelBuilt(level, image, finished);
+                }
+            }, Qt::QueuedConnection);
+        }
+    });
+}
+
+void TiledImageItem::onLevelBuilt(int level, const QImage &image, bool finished)
+{
+    m_levels[level] = image;
+    m_builtLevels = level + 1;
+    
+    if (finished) {
+        m_building = false;
+        if (m_wantedLevel >= m_builtLevels) {
+            requestLevel(m_wantedLevel);
+        }
+    }
+    
+    update();
+}
+
+QImage TiledImageItem::halveImage(const QImage &image)
+{
+    TRACE_SCOPE("TiledImageItem::halveImage");
+    // 2x2 box filter on premultiplied pixels; odd edges reuse the last pixel
+    QImage source = image;
+    if (source.format() != QImage::Format_ARGB32_Premultiplied) {
+        source = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    
+    const int sourceWidth = source.width();
+    const int sourceHeight = source.height();
+    QImage result(qMax(1, (sourceWidth + 1) / 2), qMax(1, (sourceHeight + 1) / 2),
+                  QImage::Format_ARGB32_Premultiplied);
+    
+    const uchar *inBits = source.constBits();
+    uchar *outBits = result.bits();
+    const qsizetype inStride = source.bytesPerLine();
+    const qsizetype outStride = result.bytesPerLine();
+    const int width = result.width();
+    
+    ParallelFor::run(result.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const QRgb *row0 = reinterpret_cast<const QRgb*>(inBits + (2 * y) * inStride);
+            const QRgb *row1 = reinterpret_cast<const QRgb*>(inBits + qMin(2 * y + 1, sourceHeight - 1) * inStride);
+            QRgb *out = reinterpret_cast<QRgb*>(outBits + y * outStride);
+            
+            for (int x = 0; x < width; ++x) {
+                int x0 = 2 * x;
+                int x1 = qMin(x0 + 1, sourceWidth - 1);
+                QRgb p0 = row0[x0], p1 = row0[x1], p2 = row1[x0], p3 = row1[x1];
+                
+                // Average two channels at a time in 16-bit lanes
+                quint32 rb = (p0 & 0x00ff00ff) + (p1 & 0x00ff00ff) + (p2 & 0x00ff00ff) + (p3 & 0x00ff00ff);
+                quint32 ag = ((p0 >> 8) & 0x00ff00ff) + ((p1 >> 8) & 0x00ff00ff)
+                           + ((p2 >> 8) & 0x00ff00ff) + ((p3 >> 8) & 0x00ff00ff);
+                rb = ((rb + 0x00020002) >> 2) & 0x00ff00ff;
+                ag = ((ag + 0x00020002) >> 2) & 0x00ff00ff;
+                out[x] = rb | (ag << 8);
+            }
+        }
+    });
+    
+    return result;
+}
@@ -0,0 +1,72 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef TILEDIMAGEITEM_H
+#define TILEDIMAGEITEM_H
+
+#include <QGraphicsObject>
+#include <QImage>
+#include <QPixmap>
+#include <QCache>
+#include <QList>
+#include <QSize>
+#include <atomic>
+#include <memory>
+
+// Draws an image from a power-of-two pyramid of 256x256 tiles. Level 0 is the
+// image itself; coarser levels are built on a background thread the first
+// time the view zooms out far enough to need them, with a point-sampled
+// thumbnail standing in meanwhile. The item's coordinates are
+// always in source pixels, whatever level is on screen. A reduced-resolution
+// image (e.g. an adjustment preview) can be shown by passing the size of the
+// source it stands in for.
+class TiledImageItem : public QGraphicsObject
+{
+    Q_OBJECT
+
+public:
+    static const int TileSize = 256;
+    
+    explicit TiledImageItem(const QImage &image, const QSize &sourceSize = QSize(),
+                            QGraphicsItem *parent = nullptr);
+    ~TiledImageItem() override;
+    
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+    
+    // Replaces the pixels, e.g. with a new adjustment preview, keeping the
+    // item in the scene. Coarser levels and cached tiles are rebuilt.
+    void setImage(const QImage &image, const QSize &sourceSize = QSize());
+    
+    int levelCount() const { return m_levelSizes.size(); }
+    
+    // Memory held beyond the level 0 image, which belongs to the caller
+    qint64 pyramidBytes() const;
+    qint64 tileCacheBytes() const { return static_cast<qint64>(m_tileCache.totalCost()) * 1024; }
+
+private:
+    QSize m_sourceSize;
+    QList<QSize> m_levelSizes;
+    QList<QImage> m_levels;   // Null until built
+    int m_builtLevels;        // Levels [0, m_builtLevels) are available
+    int m_wantedLevel;
+    bool m_building;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+    
+    QCache<quint64, QPixmap> m_tileCache;
+    QPixmap m_placeholder;    // Point-sampled coarsest level, shown until the real one is built
+    
+    void resetLevels(const QImage &image);
+    int levelForScale(qreal scale) const;
+    void requestLevel(int level);
+    void onLevelBuilt(int level, const QImage &image, bool finished);
+    QPixmap tilePixmap(int level, int column, int row);
+    const QPixmap &placeholder();
+    
+    static QImage halveImage(const QImage &image);
+};
+
+#endif // TILEDIMAGEITEM_H
@@ -0,0 +1,164 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "Trace.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+#include <chrono>
+#include <vector>
+
+const char *Trace::EnvironmentVariable = "WALLPAPERMAKER_TRACE";
+std::atomic<bool> Trace::s_enabled{false};
+
+namespace {
+
+struct Event {
+    const char *name;
+    qint64 startNs;
+    qint64 durationNs;
+    int thread;
+};
+
+// Enough for hours of interactive use; later spans are counted, not kept
+constexpr size_t kMaxEvents = 1 << 20;
+
+QMutex s_mutex;
+std::vector<Event> s_events;
+QStringList s_threadNames;    // Indexed by trace thread id
+QString s_outputPath;
+qint64 s_originNs = 0;
+qint64 s_dropped = 0;
+bool s_postRoutineAdded = false;
+
+// Small sequential ids read better in trace viewers than native handles.
+// Called with s_mutex held.
+int currentThreadId()
+{
+    thread_local int id = -1;
+    if (id < 0) {
+        id = s_threadNames.size();
+        QThread *thread = QThread::currentThread();
+        QCoreApplication *app = QCoreApplication::instance();
+        if (app && thread == app->thread()) {
+            s_threadNames << "main";
+        } else if (!thread->objectName().isEmpty()) {
+            s_threadNames << thread->objectName();
+        } else {
+            s_threadNames << QString("worker %1").arg(id);
+        }
+    }
+    return id;
+}
+
+QString jsonEscaped(QString text)
+{
+    return text.replace('\\', "\\\\").replace('"', "\\\"");
+}
+
+} // namespace
+
+void Trace::startFromArguments(const QStringList &arguments)
+{
+    QString path;
+    for (int i = 1; i < arguments.size(); ++i) {
+        if (arguments[i] == "--trace" && i + 1 < arguments.size()) {
+            path = arguments[i + 1];
+        } else if (arguments[i].startsWith("--trace=")) {
+            path = arguments[i].mid(8);
+        }
+    }
+    if (path.isEmpty()) {
+        path = qEnvironmentVariable(EnvironmentVariable);
+    }
+    if (!path.isEmpty()) {
+        start(path);
+    }
+}
+
+void Trace::start(const QString &outputPath)
+{
+    QMutexLocker locker(&s_mutex);
+    s_outputPath = outputPath;
+    s_events.clear();
+    s_events.reserve(64 * 1024);
+    s_dropped = 0;
+    s_originNs = nowNs();
+    
+    if (!s_postRoutineAdded) {
+        qAddPostRoutine([]() { finish(); });
+        s_postRoutineAdded = true;
+    }
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+qint64 Trace::nowNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::record(const char *name, qint64 startNs, qint64 durationNs)
+{
+    QMutexLocker locker(&s_mutex);
+    if (!isEnabled()) {
+        return;
+    }
+    if (s_events.size() >= kMaxEvents) {
+        ++s_dropped;
+        return;
+    }
+    s_events.push_back({name, startNs, durationNs, currentThreadId()});
+}
+
+bool Trace::finish()
+{
+    QMutexLocker locker(&s_mutex);
+    if (!isEnabled()) {
+        return false;
+    }
+    s_enabled.store(false, std::memory_order_relaxed);
+    
+    QFile file(s_outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "Cannot write trace file" << s_outputPath << ":" << file.errorString();
+        return false;
+    }
+    
+    // Complete ("X") events with microsecond timestamps, plus metadata
+    // naming the process and each thread
+    const qint64 pid = QCoreApplication::applicationPid();
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << QString("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%1,\"args\":{\"name\":\"%2\"}}")
+           .arg(pid).arg(jsonEscaped(QCoreApplication::applicationName()));
+    for (int i = 0; i < s_threadNames.size(); ++i) {
+        out << QString(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%1,\"tid\":%2,"
+                       "\"args\":{\"name\":\"%3\"}}")
+               .arg(pid).arg(i).arg(jsonEscaped(s_threadNames[i]));
+    }
+    for (const Event &event : s_events) {
+        out << QString(",\n{\"name\":\"%1\",\"cat\":\"wallpapermaker\",\"ph\":\"X\",\"ts\":%2,\"dur\":%3,"
+                       "\"pid\":%4,\"tid\":%5}")
+               .arg(QLatin1String(event.name))
+               .arg((event.startNs - s_originNs) / 1000.0, 0, 'f', 3)
+               .arg(event.durationNs / 1000.0, 0, 'f', 3)
+               .arg(pid)
+               .arg(event.thread);
+    }
+    out << "\n]}\n";
+    
+    if (s_dropped > 0) {
+        qWarning() << "Trace buffer full," << s_dropped << "spans were not recorded";
+    }
+    s_events.clear();
+    s_events.shrink_to_fit();
+    return out.status() == QTextStream::Ok;
+}
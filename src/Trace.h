@@ -0,0 +1,66 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QStringList>
+#include <atomic>
+
+// Scoped timing spans written as Chrome trace-event JSON, which Perfetto
+// and chrome://tracing open directly. Tracing is off unless started with
+// --trace FILE or the WALLPAPERMAKER_TRACE environment variable; a disabled
+// span costs one relaxed atomic load. The file is written when the
+// application object is destroyed.
+class Trace
+{
+public:
+    static const char *EnvironmentVariable;
+    
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    
+    // Starts recording if arguments hold --trace FILE or the environment
+    // variable names a file
+    static void startFromArguments(const QStringList &arguments);
+    static void start(const QString &outputPath);
+    static bool finish(); // Writes the file and stops recording
+    
+    // Name must outlive the trace; string literals are expected
+    static void record(const char *name, qint64 startNs, qint64 durationNs);
+    static qint64 nowNs();
+    
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name)
+            : m_name(name)
+            , m_start(isEnabled() ? nowNs() : -1)
+        {
+        }
+        ~Scope()
+        {
+            if (m_start >= 0) {
+                record(m_name, m_start, nowNs() - m_start);
+            }
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    
+    private:
+        const char *m_name;
+        qint64 m_start;
+    };
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif // TRACE_H
@@ -0,0 +1,22 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include <QCoreApplication>
+#include "BatchProcessor.h"
+
+// Batch mode as its own executable, linked against the core library only,
+// for machines without a display or the widget libraries. Takes the same
+// options as WallpaperMaker --batch; --batch itself is optional here.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("WallpaperMaker");
+    QCoreApplication::setApplicationVersion("1.0.0");
+    QCoreApplication::setOrganizationName("WallpaperMaker");
+    QCoreApplication::setOrganizationDomain("wallpapermaker.local");
+    
+    return BatchProcessor::run(app.arguments());
+}
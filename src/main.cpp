@@ -5,19 +5,37 @@
 //  See the LICENSE file for full details
 //===========================================
 #include <QApplication>
+#include <QCoreApplication>
 #include <QStyleFactory>
 #include <QDir>
 #include "MainWindow.h"
+#include "BatchProcessor.h"
+#include "Trace.h"
+
+static void setApplicationProperties()
+{
+    QCoreApplication::setApplicationName("WallpaperMaker");
+    QCoreApplication::setApplicationVersion("1.0.0");
+    QCoreApplication::setOrganizationName("WallpaperMaker");
+    QCoreApplication::setOrganizationDomain("wallpapermaker.local");
+}
 
 int main(int argc, char *argv[])
 {
+    // Batch mode runs without a display, so it must not create a QApplication
+    if (BatchProcessor::isBatchInvocation(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        setApplicationProperties();
+        return BatchProcessor::run(app.arguments());
+    }
+    
     QApplication app(argc, argv);
     
     // Set application properties
-    app.setApplicationName("WallpaperMaker");
-    app.setApplicationVersion("1.0.0");
-    app.setOrganizationName("WallpaperMaker");
-    app.setOrganizationDomain("wallpapermaker.local");
+    setApplicationProperties();
+    
+    // --trace FILE or WALLPAPERMAKER_TRACE records timing spans until exit
+    Trace::startFromArguments(app.arguments());
     
     // Set a modern style if available
     QStringList availableStyles = QStyleFactory::keys();
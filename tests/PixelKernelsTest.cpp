@@ -0,0 +1,186 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "PixelKernels.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Runs every SIMD kernel this CPU supports against the scalar reference on
+// random rows and requires identical output. Widths cover the vector tails.
+// Every kernel, scalar included, is also checked against the original
+// double-precision brightness, contrast and saturation passes over a sweep
+// of slider values and must stay within 1 per channel.
+
+namespace {
+
+struct Setting {
+    int brightness;
+    int contrast;
+    int saturation;
+};
+
+bool compareRow(PixelKernels::Isa isa, const Setting &setting, const std::vector<QRgb> &row)
+{
+    const PixelKernels::Params params = PixelKernels::makeParams(setting.brightness, setting.contrast,
+                                                                 setting.saturation);
+    const int count = static_cast<int>(row.size());
+    std::vector<QRgb> expected(row.size());
+    std::vector<QRgb> actual(row.size());
+    PixelKernels::rowFunction(PixelKernels::Isa::Scalar)(row.data(), expected.data(), count, params);
+    PixelKernels::rowFunction(isa)(row.data(), actual.data(), count, params);
+    
+    for (int x = 0; x < count; ++x) {
+        if (actual[x] != expected[x]) {
+            std::fprintf(stderr, "%s differs at x=%d of %d (brightness %d, contrast %d, saturation %d): "
+                         "input %08x, scalar %08x, got %08x\n",
+                         qPrintable(PixelKernels::isaName(isa)), x, count, setting.brightness,
+                         setting.contrast, setting.saturation, row[x], expected[x], actual[x]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// The separate passes applyAdjustments used to chain, one pixel at a time
+QRgb chainedReference(QRgb pixel, const Setting &setting)
+{
+    int r = qRed(pixel);
+    int g = qGreen(pixel);
+    int b = qBlue(pixel);
+    
+    if (setting.brightness != 0) {
+        const int adjustment = setting.brightness * 255 / 100;
+        r = qBound(0, r + adjustment, 255);
+        g = qBound(0, g + adjustment, 255);
+        b = qBound(0, b + adjustment, 255);
+    }
+    
+    if (setting.contrast != 0) {
+        const double factor = (259.0 * (setting.contrast + 255.0)) / (255.0 * (259.0 - setting.contrast));
+        r = qBound(0, static_cast<int>(factor * (r - 128) + 128), 255);
+        g = qBound(0, static_cast<int>(factor * (g - 128) + 128), 255);
+        b = qBound(0, static_cast<int>(factor * (b - 128) + 128), 255);
+    }
+    
+    if (setting.saturation != 0) {
+        const double factor = (setting.saturation + 100.0) / 100.0;
+        const int gray = static_cast<int>(0.299 * r + 0.587 * g + 0.114 * b);
+        r = qBound(0, static_cast<int>(gray + factor * (r - gray)), 255);
+        g = qBound(0, static_cast<int>(gray + factor * (g - gray)), 255);
+        b = qBound(0, static_cast<int>(gray + factor * (b - gray)), 255);
+    }
+    
+    return qRgba(r, g, b, qAlpha(pixel));
+}
+
+bool compareWithReference(PixelKernels::Isa isa, const Setting &setting, const std::vector<QRgb> &row)
+{
+    const PixelKernels::Params params = PixelKernels::makeParams(setting.brightness, setting.contrast,
+                                                                 setting.saturation);
+    const int count = static_cast<int>(row.size());
+    std::vector<QRgb> actual(row.size());
+    PixelKernels::rowFunction(isa)(row.data(), actual.data(), count, params);
+    
+    for (int x = 0; x < count; ++x) {
+        const QRgb expected = chainedReference(row[x], setting);
+        for (int shift = 0; shift < 32; shift += 8) {
+            const int difference = static_cast<int>((actual[x] >> shift) & 0xff)
+                                 - static_cast<int>((expected >> shift) & 0xff);
+            if (difference < -1 || difference > 1) {
+                std::fprintf(stderr, "%s is %d from the chained passes (brightness %d, contrast %d, "
+                             "saturation %d): input %08x, expected %08x, got %08x\n",
+                             qPrintable(PixelKernels::isaName(isa)), difference, setting.brightness,
+                             setting.contrast, setting.saturation, row[x], expected, actual[x]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+}
+
+int main()
+{
+    // Fixed seed, so a failure reproduces
+    std::mt19937 random(20250101);
+    std::uniform_int_distribution<quint32> pixel;
+    std::uniform_int_distribution<int> slider(-100, 100);
+    
+    std::vector<Setting> settings = {
+        {0, 0, 0}, {100, 0, 0}, {-100, 0, 0}, {0, 100, 0}, {0, -100, 0},
+        {0, 0, 100}, {0, 0, -100}, {100, 100, 100}, {-100, -100, -100}
+    };
+    for (int i = 0; i < 32; ++i) {
+        settings.push_back({slider(random), slider(random), slider(random)});
+    }
+    
+    std::vector<int> widths;
+    for (int width = 1; width <= 67; width += 2) {
+        widths.push_back(width);
+    }
+    widths.push_back(1921);
+    widths.push_back(4097);
+    
+    int checked = 0;
+    int failures = 0;
+    for (PixelKernels::Isa isa : {PixelKernels::Isa::SSE41, PixelKernels::Isa::AVX2}) {
+        if (!PixelKernels::isSupported(isa)) {
+            std::printf("%s: not supported on this CPU, skipped\n", qPrintable(PixelKernels::isaName(isa)));
+            continue;
+        }
+        
+        for (const Setting &setting : settings) {
+            for (int width : widths) {
+                std::vector<QRgb> row(width);
+                for (QRgb &value : row) {
+                    value = pixel(random);
+                }
+                if (!compareRow(isa, setting, row)) {
+                    ++failures;
+                }
+                ++checked;
+            }
+        }
+        std::printf("%s: checked against scalar\n", qPrintable(PixelKernels::isaName(isa)));
+    }
+    
+    // Every slider combination in steps of 20, plus a known hard case
+    std::vector<Setting> sweep;
+    for (int brightness = -100; brightness <= 100; brightness += 20) {
+        for (int contrast = -100; contrast <= 100; contrast += 20) {
+            for (int saturation = -100; saturation <= 100; saturation += 20) {
+                sweep.push_back({brightness, contrast, saturation});
+            }
+        }
+    }
+    sweep.push_back({-80, 20, 10});
+    
+    int swept = 0;
+    int outOfRange = 0;
+    for (PixelKernels::Isa isa : {PixelKernels::Isa::Scalar, PixelKernels::Isa::SSE41, PixelKernels::Isa::AVX2}) {
+        if (!PixelKernels::isSupported(isa)) {
+            continue;
+        }
+        
+        for (const Setting &setting : sweep) {
+            std::vector<QRgb> row(509);
+            for (QRgb &value : row) {
+                value = pixel(random);
+            }
+            row[0] = qRgb(172, 249, 250);
+            if (!compareWithReference(isa, setting, row)) {
+                ++outOfRange;
+            }
+            ++swept;
+        }
+        std::printf("%s: checked against the chained passes\n", qPrintable(PixelKernels::isaName(isa)));
+    }
+    
+    std::printf("%d rows compared, %d mismatched\n", checked, failures);
+    std::printf("%d rows swept, %d more than 1 from the chained passes\n", swept, outOfRange);
+    return failures == 0 && outOfRange == 0 ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "ScanlineReader.h"
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <QImageReader>
+#include <QImageWriter>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+// Writes small files in each format the reader streams and checks that
+// overlapping strips, as the resampler requests them, match the rows of a
+// single whole read; for lossless formats, also that they match Qt's decode.
+
+namespace {
+
+QImage testImage(int width, int height, bool alpha, bool deep)
+{
+    std::mt19937 random(width * 31 + height);
+    if (deep) {
+        // Random 16-bit samples, so most of them fall between 8-bit values
+        // and the reader has to round them the way Qt's conversion does
+        QImage image(width, height, alpha ? QImage::Format_RGBA64 : QImage::Format_RGBX64);
+        for (int y = 0; y < height; ++y) {
+            QRgba64 *line = reinterpret_cast<QRgba64*>(image.scanLine(y));
+            for (int x = 0; x < width; ++x) {
+                line[x] = QRgba64::fromRgba64(random() & 0xffff, random() & 0xffff, random() & 0xffff,
+                                              alpha ? random() & 0xffff : 0xffff);
+            }
+        }
+        return image;
+    }
+    
+    QImage image(width, height, alpha ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            // Smooth enough for JPEG, with some noise so rows differ
+            const int noise = static_cast<int>(random() % 32);
+            line[x] = qRgba((x * 255 / width + noise) & 0xff, (y * 255 / height) & 0xff, (x + y + noise) & 0xff,
+                            alpha ? (x * 7 + y) & 0xff : 255);
+        }
+    }
+    return image;
+}
+
+bool sameRows(const QImage &a, int aTop, const QImage &b, int bTop, int rows)
+{
+    for (int y = 0; y < rows; ++y) {
+        if (std::memcmp(a.constScanLine(aTop + y), b.constScanLine(bTop + y), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the number of failures; formats the build cannot stream are skipped
+int check(const QString &path, const char *name, bool lossless)
+{
+    ScanlineReader whole(path);
+    if (!whole.isValid()) {
+        std::printf("%s: not streamable in this build (%s), skipped\n", name, qPrintable(whole.errorString()));
+        return 0;
+    }
+    const QSize size = whole.size();
+    const QImage reference = whole.read(0, size.height());
+    if (reference.isNull()) {
+        std::printf("%s: whole read failed: %s\n", name, qPrintable(whole.errorString()));
+        return 1;
+    }
+    
+    int failures = 0;
+    if (lossless) {
+        const QImage decoded = QImageReader(path).read().convertToFormat(reference.format());
+        if (decoded.size() != size || !sameRows(decoded, 0, reference, 0, size.height())) {
+            std::printf("%s: differs from Qt's decode\n", name);
+            ++failures;
+        }
+    }
+    
+    // Strips that grow by up to 40 rows, start up to 8 rows back and
+    // sometimes leave a gap, from a random first row
+    std::mt19937 random(20250101);
+    for (int trial = 0; trial < 16; ++trial) {
+        ScanlineReader reader(path);
+        int first = static_cast<int>(random() % 16);
+        int last = first;
+        while (last < size.height()) {
+            last = qMin(size.height(), last + 1 + static_cast<int>(random() % 40));
+            const QImage strip = reader.read(first, last);
+            if (strip.isNull() || strip.height() != last - first || !sameRows(reference, first, strip, 0, last - first)) {
+                std::printf("%s: rows %d to %d differ (%s)\n", name, first, last, qPrintable(reader.errorString()));
+                ++failures;
+                break;
+            }
+            first = qMax(first, last - static_cast<int>(random() % 9));
+            if (first == last && random() % 4 == 0) {
+                first = last = qMin(size.height(), last + static_cast<int>(random() % 5));
+            }
+        }
+        
+        if (!reader.read(0, 1).isNull()) {
+            std::printf("%s: accepted a strip out of order\n", name);
+            ++failures;
+        }
+    }
+    
+    std::printf("%s: %dx%d checked\n", name, size.width(), size.height());
+    return failures;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTemporaryDir dir;
+    
+    struct Case {
+        const char *name;
+        const char *format;
+        bool alpha;
+        bool deep; // 16 bits per channel
+        bool lossless;
+    };
+    const Case cases[] = {
+        {"png", "png", false, false, true},
+        {"png-alpha", "png", true, false, true},
+        {"png-16bit", "png", false, true, true},
+        {"jpeg", "jpeg", false, false, false},
+        {"tiff", "tiff", false, false, true},
+        {"tiff-alpha", "tiff", true, false, false},
+    };
+    
+    int failures = 0;
+    for (const Case &test : cases) {
+        // Odd sizes, so strips and TIFF rows per strip never line up
+        const QString path = dir.filePath(QString("%1.%2").arg(QLatin1String(test.name), QLatin1String(test.format)));
+        QImageWriter writer(path, test.format);
+        if (!writer.write(testImage(333, 517, test.alpha, test.deep))) {
+            std::printf("%s: no writer (%s), skipped\n", test.name, qPrintable(writer.errorString()));
+            continue;
+        }
+        failures += check(path, test.name, test.lossless);
+    }
+    
+    std::printf("%d failure(s)\n", failures);
+    return failures == 0 ? 0 : 1;
+}
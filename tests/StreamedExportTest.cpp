@@ -0,0 +1,173 @@
+//===========================================
+//  wallpaper maker source code
+//  Copyright (c) 2025, jt(q5sys)
+//  Available under the MIT license
+//  See the LICENSE file for full details
+//===========================================
+#include "ImageProcessor.h"
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QTemporaryDir>
+#include <QImageWriter>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+// Loads files larger than a 1 MB memory budget, so the processor keeps only
+// a proxy and exports by streaming the file in strips, and requires the
+// streamed exports to match the in-memory export of the whole decoded image
+// pixel for pixel, with and without adjustments.
+
+namespace {
+
+QImage testImage(int width, int height, bool alpha, bool deep)
+{
+    std::mt19937 random(width * 31 + height);
+    QImage image(width, height, deep ? (alpha ? QImage::Format_RGBA64 : QImage::Format_RGBX64)
+                                     : (alpha ? QImage::Format_ARGB32 : QImage::Format_RGB32));
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            // Gradients with noise, so every filter tap carries weight
+            const int noise = static_cast<int>(random() % 64);
+            const int r = (x * 255 / width + noise) & 0xff;
+            const int g = (y * 255 / height + noise) & 0xff;
+            const int b = (x + y) & 0xff;
+            const int a = alpha ? (x * 7 + y) & 0xff : 255;
+            if (deep) {
+                reinterpret_cast<QRgba64*>(image.scanLine(y))[x] =
+                    QRgba64::fromRgba64(r * 256 + noise * 4, g * 256 + noise, b * 257, a * 257);
+            } else {
+                reinterpret_cast<QRgb*>(image.scanLine(y))[x] = qRgba(r, g, b, a);
+            }
+        }
+    }
+    return image;
+}
+
+bool load(ImageProcessor *processor, const QString &path, QString *error)
+{
+    QEventLoop loop;
+    bool loaded = false;
+    QObject::connect(processor, &ImageProcessor::imageLoaded, &loop, [&]() {
+        loaded = true;
+        loop.quit();
+    });
+    QObject::connect(processor, &ImageProcessor::loadFailed, &loop, [&](const QString &, const QString &message) {
+        *error = message;
+        loop.quit();
+    });
+    QObject::connect(processor, &ImageProcessor::errorOccurred, &loop, [&](const QString &message) {
+        *error = message;
+        loop.quit();
+    });
+    if (!processor->loadImage(path)) {
+        return false;
+    }
+    loop.exec();
+    return loaded;
+}
+
+bool sameImage(const QImage &a, const QImage &b)
+{
+    if (a.size() != b.size() || a.format() != b.format()) {
+        return false;
+    }
+    for (int y = 0; y < a.height(); ++y) {
+        if (std::memcmp(a.constScanLine(y), b.constScanLine(y), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the number of failures
+int check(const QString &path, const char *name)
+{
+    ImageProcessor processor;
+    processor.setMemoryBudgetMB(1);
+    processor.setDecodeCacheMB(0);
+    processor.setProxyCacheMB(0);
+    
+    QString error;
+    if (!load(&processor, path, &error)) {
+        std::printf("%s: load failed: %s\n", name, qPrintable(error));
+        return 1;
+    }
+    if (!processor.isStreaming()) {
+        std::printf("%s: not streamed under a 1 MB budget\n", name);
+        return 1;
+    }
+    const QImage decoded = ImageProcessor::decodeImage(path, &error);
+    if (decoded.isNull()) {
+        std::printf("%s: decode failed: %s\n", name, qPrintable(error));
+        return 1;
+    }
+    
+    struct Adjustment {
+        int brightness;
+        int contrast;
+        int saturation;
+    };
+    const Adjustment adjustments[] = {{0, 0, 0}, {20, -30, 40}, {-60, 60, -100}};
+    // A crop off the image origin, reduced, enlarged and one edge past the image
+    const QRect crops[] = {QRect(37, 21, 1000, 700), QRect(37, 21, 1000, 700), QRect(600, 500, 700, 400)};
+    const QSize targets[] = {QSize(420, 294), QSize(1300, 910), QSize(350, 200)};
+    
+    int failures = 0;
+    for (const Adjustment &adjustment : adjustments) {
+        processor.setBrightness(adjustment.brightness);
+        processor.setContrast(adjustment.contrast);
+        processor.setSaturation(adjustment.saturation);
+        for (int i = 0; i < 3; ++i) {
+            const QImage streamed = processor.renderWallpaper(targets[i], crops[i]);
+            const QImage resident = ImageProcessor::renderWallpaper(decoded, targets[i], crops[i],
+                                                                    adjustment.brightness, adjustment.contrast,
+                                                                    adjustment.saturation);
+            if (streamed.isNull() || !sameImage(streamed, resident)) {
+                std::printf("%s: %dx%d from (%d,%d %dx%d) with %d/%d/%d differs from the in-memory export\n",
+                            name, targets[i].width(), targets[i].height(), crops[i].x(), crops[i].y(),
+                            crops[i].width(), crops[i].height(), adjustment.brightness, adjustment.contrast,
+                            adjustment.saturation);
+                ++failures;
+            }
+        }
+    }
+    
+    std::printf("%s: streamed exports checked\n", name);
+    return failures;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTemporaryDir dir;
+    
+    struct Case {
+        const char *name;
+        const char *format;
+        bool alpha;
+        bool deep; // 16 bits per channel
+    };
+    // Formats whose streamed decode matches Qt's exactly
+    const Case cases[] = {
+        {"png", "png", false, false},
+        {"png-alpha", "png", true, false},
+        {"png-16bit", "png", false, true},
+        {"tiff", "tiff", false, false},
+    };
+    
+    int failures = 0;
+    for (const Case &test : cases) {
+        const QString path = dir.filePath(QString("%1.%2").arg(QLatin1String(test.name), QLatin1String(test.format)));
+        QImageWriter writer(path, test.format);
+        if (!writer.write(testImage(1201, 899, test.alpha, test.deep))) {
+            std::printf("%s: no writer (%s), skipped\n", test.name, qPrintable(writer.errorString()));
+            continue;
+        }
+        failures += check(path, test.name);
+    }
+    
+    std::printf("%d failure(s)\n", failures);
+    return failures == 0 ? 0 : 1;
+}